@@ -2,6 +2,7 @@ import datetime
 import errno
 import os
 import tarfile
+from concurrent.futures import ThreadPoolExecutor
 from configparser import ConfigParser
 from logging import Logger
 from pathlib import Path
@@ -11,7 +12,7 @@ import requests
 from werkzeug.utils import secure_filename
 
 from pbench.agent import PbenchAgentConfig
-from pbench.common.exceptions import BadMDLogFormat
+from pbench.common.exceptions import BadConfig, BadMDLogFormat
 from pbench.common.utils import md5sum
 
 
@@ -145,8 +146,38 @@ class MakeResultTb:
         return str(tarball)
 
 
+class FilePart:
+    """FilePart - A byte range of a file, read as a file of its own, so that
+    it can be streamed as the body of a request with a known length.
+    """
+
+    def __init__(self, path: Path, offset: int, length: int):
+        self.length = length
+        self.remaining = length
+        self.fp = path.open("rb")
+        self.fp.seek(offset)
+
+    def __len__(self) -> int:
+        return self.length
+
+    def read(self, size: int = -1) -> bytes:
+        if size < 0 or size > self.remaining:
+            size = self.remaining
+        data = self.fp.read(size)
+        self.remaining -= len(data)
+        return data
+
+    def close(self) -> None:
+        self.fp.close()
+
+
 class CopyResultTb:
     """CopyResultTb - Use the server's HTTP PUT method to upload a tarball
+
+    Tarballs larger than the configured "upload_part_size" are uploaded in
+    parts, "upload_concurrency" of them at a time, through an upload session
+    which the server assembles once all the parts are received; with the
+    default concurrency of 1, tarballs are always uploaded in one request.
     """
 
     chunk_size = 4096
@@ -160,6 +191,20 @@ class CopyResultTb:
         self.logger = logger
         server_rest_url = config.get("results", "server_rest_url")
         self.upload_url = f"{server_rest_url}/upload/ctrl/{controller}"
+        self.session_url = f"{server_rest_url}/upload/session/{controller}"
+        try:
+            self.upload_part_size = config.conf.getint(
+                "results", "upload_part_size", fallback=64 * 1024 * 1024
+            )
+            self.upload_concurrency = config.conf.getint(
+                "results", "upload_concurrency", fallback=1
+            )
+        except ValueError as exc:
+            raise BadConfig(str(exc))
+        if self.upload_part_size < 1 or self.upload_concurrency < 1:
+            raise BadConfig(
+                "upload_part_size and upload_concurrency must be positive integers"
+            )
 
     def read_in_chunks(self, file_object: IO) -> Iterator[bytes]:
         data = file_object.read(self.chunk_size)
@@ -176,6 +221,9 @@ class CopyResultTb:
                     specific user.
         """
         content_length, content_md5 = md5sum(self.tarball)
+        if self.upload_concurrency > 1 and content_length > self.upload_part_size:
+            self.copy_result_tb_parts(token, content_length, content_md5)
+            return
         headers = {
             "filename": secure_filename(str(self.tarball)),
             "Content-MD5": content_md5,
@@ -199,3 +247,93 @@ class CopyResultTb:
         assert (
             response.ok
         ), f"Logic bomb!  Unexpected error response, '{response.reason}' ({response.status_code})"
+
+    def copy_result_tb_parts(
+        self, token: str, content_length: int, content_md5: str
+    ) -> None:
+        """copy_result_tb_parts - copies tb from agent to the configured server
+            upload session URL, in parts uploaded concurrently
+
+            Args
+                token -- a token which establishes that the caller is
+                    authorized to make the requests on behalf of a
+                    specific user.
+                content_length -- the size of the tarball
+                content_md5 -- the MD5 of the tarball
+        """
+        auth = {"Authorization": f"Bearer {token}"}
+        headers = {
+            "filename": secure_filename(str(self.tarball)),
+            "Content-MD5": content_md5,
+            **auth,
+        }
+        url = self.session_url
+        try:
+            response = requests.post(url, headers=headers)
+            response.raise_for_status()
+            body = response.json()
+            session_id = body.get("session_id")
+            if session_id is None:
+                # The server already has a dataset for this tarball; it is
+                # only safe to consider it uploaded once the server says it
+                # got past uploading it.
+                state = body.get("state")
+                if state in (None, "UPLOADING", "QUARANTINED"):
+                    raise FileUploadError(
+                        f"the server's dataset is in state {state}"
+                        f" ({body.get('message')})"
+                    )
+                self.logger.info("File already uploaded, state {}", state)
+                return
+            url = f"{self.session_url}/{session_id}"
+
+            parts = [
+                (offset, min(self.upload_part_size, content_length - offset))
+                for offset in range(0, content_length, self.upload_part_size)
+            ]
+            self.logger.debug(
+                "Uploading {} in {:d} parts, {:d} at a time",
+                self.tarball,
+                len(parts),
+                self.upload_concurrency,
+            )
+            with ThreadPoolExecutor(max_workers=self.upload_concurrency) as executor:
+                futures = [
+                    executor.submit(
+                        self.put_part,
+                        f"{url}/part",
+                        auth,
+                        offset,
+                        length,
+                        content_length,
+                    )
+                    for offset, length in parts
+                ]
+                for future in futures:
+                    future.result()
+
+            response = requests.post(url, headers=auth)
+            response.raise_for_status()
+            self.logger.info("File uploaded successfully")
+        except requests.exceptions.ConnectionError:
+            raise RuntimeError(f"Cannot connect to '{url}'")
+        except Exception as exc:
+            raise FileUploadError(
+                "There was something wrong with file upload request:  "
+                f"file: '{self.tarball}', URL: '{url}', ({exc})"
+            )
+
+    def put_part(
+        self, url: str, auth: dict, offset: int, length: int, content_length: int
+    ) -> None:
+        """put_part - uploads one part of the tarball"""
+        headers = {
+            "Content-Range": f"bytes {offset}-{offset + length - 1}/{content_length}",
+            **auth,
+        }
+        part = FilePart(self.tarball, offset, length)
+        try:
+            response = requests.put(url, data=part, headers=headers)
+            response.raise_for_status()
+        finally:
+            part.close()
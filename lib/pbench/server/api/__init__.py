@@ -13,7 +13,12 @@ from flask_cors import CORS
 
 from pbench.server import PbenchServerConfig
 from pbench.common.exceptions import BadConfig, ConfigFileNotSpecified
-from pbench.server.api.resources.upload_api import Upload, HostInfo
+from pbench.server.api.resources.upload_api import (
+    HostInfo,
+    Upload,
+    UploadPart,
+    UploadSession,
+)
 from pbench.server.api.resources.graphql_api import GraphQL
 from pbench.server.api.resources.endpoint_configure import EndpointConfig
 from pbench.common.logger import get_pbench_logger
@@ -50,6 +55,17 @@ def register_endpoints(api, app, config):
         f"{base_uri}/upload/ctrl/<string:controller>",
         resource_class_args=(config, logger),
     )
+    api.add_resource(
+        UploadSession,
+        f"{base_uri}/upload/session/<string:controller>",
+        f"{base_uri}/upload/session/<string:controller>/<string:session_id>",
+        resource_class_args=(config, logger),
+    )
+    api.add_resource(
+        UploadPart,
+        f"{base_uri}/upload/session/<string:controller>/<string:session_id>/part",
+        resource_class_args=(config, logger),
+    )
     api.add_resource(
         HostInfo, f"{base_uri}/host_info", resource_class_args=(config, logger),
     )
@@ -18,6 +18,7 @@ class EndpointConfig(Resource):
     forward_pattern = re.compile(r";\s*host\s*=\s*(?P<host>[^;\s]+)")
     x_forward_pattern = re.compile(r"\s*(?P<host>[^;\s,]+)")
     param_template = re.compile(r"<\w+:\w+>")
+    repeated_slashes = re.compile(r"//+")
 
     def __init__(self, config: PbenchServerConfig, logger: Logger):
         """
@@ -138,11 +139,16 @@ class EndpointConfig(Resource):
                 # while "/api/v1/users/<string:username>" yields:
                 #     "users": "/api/v1/users/"
                 #
+                # Consecutive template strings leave consecutive "/"
+                # characters behind, which we collapse, so that, e.g.,
+                # "/api/v1/upload/session/<string:controller>/<string:id>"
+                # yields the same "upload_session" API as its first template.
+                #
                 # TODO: This won't work right with embedded template strings,
                 # which we're not currently using anywhere; but it'll require
                 # adjustment later if we add any. (E.g., something like
                 # "/api/v1/foo/<string:name>/detail/<string:param>")
-                url = self.param_template.sub("", url)
+                url = self.repeated_slashes.sub("/", self.param_template.sub("", url))
                 path = url[len(self.uri_prefix) + 1 :]
                 if path.endswith("/"):
                     path = path[:-1]
@@ -1,20 +1,41 @@
+import datetime
+import fcntl
 import hashlib
+import json
 import os
+import re
+import shutil
 import tempfile
+import threading
+import time
+import uuid
 from http import HTTPStatus
 from pathlib import Path
 
 import humanize
 from flask import jsonify, request
 from flask_restful import Resource, abort
+from werkzeug.http import parse_content_range_header
 from werkzeug.utils import secure_filename
 
+from pbench.common.utils import md5sum as md5sum_file
 from pbench.server.api.auth import Auth
-from pbench.server.database.models.tracker import Dataset, DatasetDuplicate, States
+from pbench.server.database.database import Database
+from pbench.server.database.models.tracker import (
+    Dataset,
+    DatasetDuplicate,
+    DatasetError,
+    States,
+)
+from pbench.server.fingerprint import Fingerprints
 from pbench.server.utils import filesize_bytes
+from pbench.server.work_queue import WorkQueue
 
 ALLOWED_EXTENSIONS = {"xz"}
 
+# Days after which an upload session without activity is abandoned.
+DEFAULT_SESSION_MAX_DAYS = 7
+
 
 class HostInfo(Resource):
     def __init__(self, config, logger):
@@ -40,9 +61,18 @@ class HostInfo(Resource):
 
 
 class Upload(Resource):
+    # Size of the buffer the body of a request is read into, see _receive().
+    receive_buffer_size = 1024 * 1024
+    _buffers = threading.local()
+
+    # The resolved receive directory, by "pbench-receive-dir-prefix" value.
+    _upload_directories = {}
+
     def __init__(self, config, logger):
         self.config = config
         self.logger = logger
+        self.fingerprints = Fingerprints(config, logger)
+        self.work_queue = WorkQueue.enabled(config, logger)
         self.max_content_length = filesize_bytes(
             self.config.get_conf(
                 __name__, "pbench-server", "rest_max_content_length", self.logger
@@ -52,37 +82,8 @@ class Upload(Resource):
     @Auth.token_auth.login_required()
     def put(self, controller):
 
-        try:
-            username = Auth.token_auth.current_user().username
-        except Exception:
-            self.logger.exception("Tarfile upload: Exception verifying the username")
-            abort(HTTPStatus.INTERNAL_SERVER_ERROR, message="INTERNAL ERROR")
-
-        if not request.headers.get("filename"):
-            self.logger.debug(
-                "Tarfile upload: Post operation failed due to missing filename header"
-            )
-            abort(
-                400,
-                message="Missing filename header, POST operation requires a filename header to name the uploaded file",
-            )
-        filename = secure_filename(request.headers.get("filename"))
-
-        if not request.headers.get("Content-MD5"):
-            self.logger.debug(
-                f"Tarfile upload: Post operation failed due to missing md5sum header for file {filename}"
-            )
-            abort(
-                400,
-                message="Missing md5sum header, POST operation requires md5sum of an uploaded file in header",
-            )
-        md5sum = request.headers.get("Content-MD5")
-
-        if not self.allowed_file(filename):
-            self.logger.debug(
-                f"Tarfile upload: Bad file extension received for file {filename}"
-            )
-            abort(400, message="File extension not supported. Only .xz")
+        username = self._username()
+        filename, md5sum = self._file_headers()
 
         try:
             content_length = int(request.headers.get("Content-Length"))
@@ -115,11 +116,69 @@ class Upload(Resource):
                     message="Upload failed, Content-Length received in header is 0",
                 )
 
+        created = self._create_dataset(username, controller, filename, md5sum)
+        if created is None:
+            return self._exists(controller, filename)
+        dataset, tar_full_path, md5_full_path = created
+        path = tar_full_path.parent
+
+        self.logger.info("Uploading file {} to {}", filename, dataset)
+
+        with tempfile.NamedTemporaryFile(mode="wb", dir=path) as ofp:
+            self.logger.debug("Writing chunks")
+            self._preallocate(ofp, content_length)
+            hash_md5 = hashlib.md5()
+
+            try:
+                bytes_received = self._receive(ofp, content_length, hash_md5)
+            except Exception:
+                self.logger.exception(
+                    "Tarfile upload: There was something wrong uploading {}", filename
+                )
+                abort(500, message=f"There was something wrong uploading {filename}")
+
+            if bytes_received != content_length:
+                self.logger.debug(
+                    f"Tarfile upload: Bytes received does not match with content length header value for file {filename}"
+                )
+                message = (
+                    f"Bytes received ({bytes_received}) does not match with content length header"
+                    f" ({content_length}), upload failed"
+                )
+                abort(400, message=message)
+
+            elif hash_md5.hexdigest() != md5sum:
+                self.logger.debug(
+                    f"Tarfile upload: md5sum check failed for file {filename}"
+                )
+                message = f"md5sum check failed for {filename}, upload failed"
+                abort(400, message=message)
+
+            self._link_into_place(
+                ofp.name, tar_full_path, md5_full_path, md5sum, filename
+            )
+
+        self.fingerprints.record(tar_full_path, md5sum, dataset)
+        try:
+            dataset.advance(States.UPLOADED)
+        except Exception:
+            self.logger.exception("Unable to finalize {}", dataset)
+            abort(HTTPStatus.INTERNAL_SERVER_ERROR, message="INTERNAL ERROR")
+        if self.work_queue:
+            WorkQueue.enqueue(dataset, self.logger)
+        response = jsonify(dict(message="File successfully uploaded"))
+        response.status_code = 201
+        return response
+
+    def _create_dataset(self, username, controller, filename, md5sum):
+        """Create the tracking dataset of the tar ball being uploaded, in the
+        UPLOADING state, returning it along with the paths of the tar ball and
+        its .md5 file, or None if the dataset already exists.
+        """
         path = self.upload_directory / controller
         path.mkdir(exist_ok=True)
         tar_full_path = Path(path, filename)
         md5_full_path = Path(path, f"{filename}.md5")
-        bytes_received = 0
 
         # Create a tracking dataset object; it'll begin in UPLOADING state
         try:
@@ -129,9 +188,7 @@ class Upload(Resource):
             dataset.add()
         except DatasetDuplicate:
             self.logger.info("Dataset already exists {}", filename)
-            response = jsonify(dict(message="Dataset already exists"))
-            response.status_code = 200
-            return response
+            return None
         except Exception:
             self.logger.exception("unable to create dataset for {}", filename)
             abort(
@@ -146,89 +203,148 @@ class Upload(Resource):
             abort(
                 HTTPStatus.INTERNAL_SERVER_ERROR, message="INTERNAL ERROR",
             )
+        return dataset, tar_full_path, md5_full_path
 
-        self.logger.info("Uploading file {} to {}", filename, dataset)
+    def _exists(self, controller, filename):
+        """Return the response to the upload of a tar ball whose dataset
+        already exists, giving the state of that dataset, so that the client
+        can tell whether the upload completed.
+        """
+        try:
+            state = Dataset.attach(controller=controller, path=filename).state.name
+        except DatasetError:
+            state = None
+        response = jsonify(dict(message="Dataset already exists", state=state))
+        response.status_code = 200
+        return response
 
-        with tempfile.NamedTemporaryFile(mode="wb", dir=path) as ofp:
-            chunk_size = 4096
-            self.logger.debug("Writing chunks")
-            hash_md5 = hashlib.md5()
+    @classmethod
+    def _receive(cls, ofp, content_length, hash_md5=None):
+        """Write the body of the request to the given file, updating the given
+        MD5 hash with it, and returning the number of bytes received; more
+        than content_length bytes are never written.
 
-            try:
-                while True:
-                    chunk = request.stream.read(chunk_size)
-                    bytes_received += len(chunk)
-                    if len(chunk) == 0 or bytes_received > content_length:
-                        break
+        The body is read a large block at a time, straight into a buffer
+        kept for the requests handled by the same thread.
+        """
+        try:
+            buf = cls._buffers.buf
+        except AttributeError:
+            buf = cls._buffers.buf = bytearray(cls.receive_buffer_size)
+        view = memoryview(buf)
+        stream = request.stream
+        readinto = getattr(stream, "readinto", None)
+        bytes_received = 0
+        while True:
+            if readinto is not None:
+                data = view[: readinto(view) or 0]
+            else:
+                data = stream.read(len(buf))
+            bytes_received += len(data)
+            if len(data) == 0 or bytes_received > content_length:
+                break
 
-                    ofp.write(chunk)
-                    hash_md5.update(chunk)
-            except Exception:
-                self.logger.exception(
-                    "Tarfile upload: There was something wrong uploading {}", filename
-                )
-                abort(500, message=f"There was something wrong uploading {filename}")
+            ofp.write(data)
+            if hash_md5 is not None:
+                hash_md5.update(data)
+        return bytes_received
 
-            if bytes_received != content_length:
-                self.logger.debug(
-                    f"Tarfile upload: Bytes received does not match with content length header value for file {filename}"
-                )
-                message = (
-                    f"Bytes received ({bytes_received}) does not match with content length header"
-                    f" ({content_length}), upload failed"
-                )
-                abort(400, message=message)
+    @staticmethod
+    def _preallocate(ofp, length):
+        """Reserve the space of the given length for the file being written,
+        when the file system supports it, so that it is not extended a block
+        at a time.
+        """
+        try:
+            os.posix_fallocate(ofp.fileno(), 0, length)
+        except (AttributeError, OSError):
+            pass
 
-            elif hash_md5.hexdigest() != md5sum:
-                self.logger.debug(
-                    f"Tarfile upload: md5sum check failed for file {filename}"
-                )
-                message = f"md5sum check failed for {filename}, upload failed"
-                abort(400, message=message)
+    def _link_into_place(
+        self, tmp_name, tar_full_path, md5_full_path, md5sum, filename
+    ):
+        """Write the .md5 file of the uploaded tar ball, and link the file
+        holding its data into place.
+
+        Neither is done when a tar ball is already in place, so that its .md5
+        file is left alone.
+        """
+        if os.path.lexists(tar_full_path):
+            self.logger.error("Tar ball {} is already in place", tar_full_path)
+            raise FileExistsError(str(tar_full_path))
 
-            # First write the .md5
+        # First write the .md5
+        try:
+            with md5_full_path.open("w") as md5fp:
+                md5fp.write(f"{md5sum} {filename}\n")
+        except Exception:
             try:
-                with md5_full_path.open("w") as md5fp:
-                    md5fp.write(f"{md5sum} {filename}\n")
-            except Exception:
-                try:
-                    os.remove(md5_full_path)
-                except FileNotFoundError:
-                    pass
-                except Exception as exc:
-                    self.logger.warning(
-                        "Failed to remove .md5 %s when trying to clean up: %s",
-                        md5_full_path,
-                        exc,
-                    )
-                self.logger.exception("Failed to write .md5 file, '%s'", md5_full_path)
-                raise
+                os.remove(md5_full_path)
+            except FileNotFoundError:
+                pass
+            except Exception as exc:
+                self.logger.warning(
+                    "Failed to remove .md5 %s when trying to clean up: %s",
+                    md5_full_path,
+                    exc,
+                )
+            self.logger.exception("Failed to write .md5 file, '%s'", md5_full_path)
+            raise
 
-            # Then create the final filename link to the temporary file.
+        # Then create the final filename link to the temporary file.
+        try:
+            os.link(tmp_name, tar_full_path)
+        except Exception:
             try:
-                os.link(ofp.name, tar_full_path)
-            except Exception:
-                try:
-                    os.remove(md5_full_path)
-                except Exception as exc:
-                    self.logger.warning(
-                        "Failed to remove .md5 %s when trying to clean up: %s",
-                        md5_full_path,
-                        exc,
-                    )
-                self.logger.exception(
-                    "Failed to rename tar ball '%s' to '%s'", ofp.name, md5_full_path,
+                os.remove(md5_full_path)
+            except Exception as exc:
+                self.logger.warning(
+                    "Failed to remove .md5 %s when trying to clean up: %s",
+                    md5_full_path,
+                    exc,
                 )
-                raise
+            self.logger.exception(
+                "Failed to rename tar ball '%s' to '%s'", tmp_name, md5_full_path,
+            )
+            raise
 
+    def _username(self):
         try:
-            dataset.advance(States.UPLOADED)
+            return Auth.token_auth.current_user().username
         except Exception:
-            self.logger.exception("Unable to finalize {}", dataset)
+            self.logger.exception("Tarfile upload: Exception verifying the username")
             abort(HTTPStatus.INTERNAL_SERVER_ERROR, message="INTERNAL ERROR")
-        response = jsonify(dict(message="File successfully uploaded"))
-        response.status_code = 201
-        return response
+
+    def _file_headers(self):
+        """Return the name and MD5 of the tar ball being uploaded, from the
+        request's "filename" and "Content-MD5" headers.
+        """
+        if not request.headers.get("filename"):
+            self.logger.debug(
+                "Tarfile upload: Post operation failed due to missing filename header"
+            )
+            abort(
+                400,
+                message="Missing filename header, POST operation requires a filename header to name the uploaded file",
+            )
+        filename = secure_filename(request.headers.get("filename"))
+
+        if not request.headers.get("Content-MD5"):
+            self.logger.debug(
+                f"Tarfile upload: Post operation failed due to missing md5sum header for file {filename}"
+            )
+            abort(
+                400,
+                message="Missing md5sum header, POST operation requires md5sum of an uploaded file in header",
+            )
+        md5sum = request.headers.get("Content-MD5")
+
+        if not self.allowed_file(filename):
+            self.logger.debug(
+                f"Tarfile upload: Bad file extension received for file {filename}"
+            )
+            abort(400, message="File extension not supported. Only .xz")
+        return filename, md5sum
 
     @staticmethod
     def allowed_file(filename):
@@ -246,7 +362,11 @@ class Upload(Resource):
             __name__, "pbench-server", "pbench-receive-dir-prefix", self.logger
         )
         try:
-            return Path(f"{prdp}-002").resolve(strict=True)
+            return self._upload_directories[prdp]
+        except KeyError:
+            pass
+        try:
+            upload_directory = Path(f"{prdp}-002").resolve(strict=True)
         except FileNotFoundError:
             self.logger.exception(
                 "pbench-receive-dir-prefix does not exist on the host"
@@ -261,3 +381,534 @@ class Upload(Resource):
             raise Exception(
                 "Some Exception occurred during setting up the upload directory on the host"
             )
+        self._upload_directories[prdp] = upload_directory
+        return upload_directory
+
+
+class UploadSession(Upload):
+    """Resumable upload of a tar ball, sent in chunks over any number of
+    requests, so that a dropped connection only loses the chunk in flight.
+
+        POST <uri>/upload/session/<controller>
+            Start a session, given the same "filename" and "Content-MD5"
+            headers as a plain upload, returning its "session_id"; the
+            tracking dataset is created in the UPLOADING state.  When the
+            same user already started a session for the same tar ball, that
+            session is returned instead; when the dataset of the tar ball
+            otherwise exists, its "state" is returned, as for a plain upload.
+
+        PUT <uri>/upload/session/<controller>/<session_id>
+            Append a chunk, described by a "Content-Range: bytes
+            <first>-<last>/<total or *>" header, which must start at the
+            committed offset.
+
+        GET <uri>/upload/session/<controller>/<session_id>
+            Return the committed "offset", the number of bytes received so
+            far, from which an interrupted upload is resumed.
+
+        POST <uri>/upload/session/<controller>/<session_id>
+            Commit the upload: the MD5 of the data received is checked, and
+            the tar ball is linked into place as for a plain upload, only
+            then advancing the dataset to UPLOADED.  A commit which failed
+            after linking the tar ball into place can be retried: it only
+            advances the dataset.
+
+    Alternatively, the tar ball can be sent as parts uploaded concurrently,
+    see UploadPart, which the commit assembles in place of any chunks.
+
+    The data received is staged in a hidden directory of the receive
+    directory, one sub-directory per session.  Sessions without activity for
+    "upload-session-max-days" days (default 7, 0 to keep them forever) are
+    removed, along with their datasets, still UPLOADING, as are the datasets
+    left UPLOADING that long by interrupted plain uploads.
+    """
+
+    sessions_dir_name = ".upload-sessions"
+    session_file_name = "session.json"
+    parts_dir_name = "parts"
+
+    # Staged parts are named after their byte range, zero padded so that the
+    # names sort in the order of the parts.
+    part_name_fmt = "{:020d}-{:020d}-{:020d}"
+    _part_name_pat = re.compile(r"(\d{20})-(\d{20})-(\d{20})")
+    assembly_block_size = 4 * 1024 * 1024
+
+    _session_id_pat = re.compile(r"[0-9a-f]{32}")
+
+    # How often (seconds) each server process looks for abandoned sessions,
+    # and when it last did.
+    expiry_interval = 60 * 60
+    _last_expiry = 0.0
+
+    def __init__(self, config, logger):
+        super().__init__(config, logger)
+        try:
+            max_days = config.conf.getint(
+                "pbench-server",
+                "upload-session-max-days",
+                fallback=DEFAULT_SESSION_MAX_DAYS,
+            )
+        except ValueError as e:
+            logger.warning("Bad upload session max days: {}", e)
+            max_days = DEFAULT_SESSION_MAX_DAYS
+        self.session_max_age = max(0, max_days) * 24 * 60 * 60
+
+    @Auth.token_auth.login_required()
+    def post(self, controller, session_id=None):
+        if session_id is None:
+            return self._start(controller)
+        return self._commit(controller, session_id)
+
+    @Auth.token_auth.login_required()
+    def get(self, controller, session_id):
+        session_dir, session = self._session(controller, session_id)
+        status = dict(
+            filename=session["filename"],
+            offset=(session_dir / session["filename"]).stat().st_size,
+        )
+        parts = [[first, stop] for first, stop, _ in self._staged_parts(session_dir)]
+        if parts:
+            status["parts"] = parts
+        response = jsonify(status)
+        response.status_code = 200
+        return response
+
+    @Auth.token_auth.login_required()
+    def put(self, controller, session_id):
+        session_dir, session = self._session(controller, session_id)
+        filename = session["filename"]
+
+        content_range, content_length = self._content_range(filename)
+
+        with (session_dir / filename).open("ab") as ofp:
+            try:
+                fcntl.flock(ofp, fcntl.LOCK_EX | fcntl.LOCK_NB)
+            except BlockingIOError:
+                abort(
+                    HTTPStatus.CONFLICT,
+                    message=f"Another chunk of {filename} is being uploaded",
+                )
+            offset = ofp.seek(0, os.SEEK_END)
+            if content_range.start != offset:
+                abort(
+                    HTTPStatus.CONFLICT,
+                    message=f"Chunk starts at byte {content_range.start:d},"
+                    f" expected byte {offset:d}",
+                    offset=offset,
+                )
+            try:
+                # Whatever part of the chunk is received is kept, so the
+                # upload can be resumed from there.
+                bytes_received = self._receive(ofp, content_length)
+            except Exception:
+                self.logger.exception(
+                    "Tarfile upload: There was something wrong uploading {}", filename
+                )
+                abort(500, message=f"There was something wrong uploading {filename}")
+            offset = ofp.tell()
+
+        if bytes_received != content_length:
+            abort(
+                400,
+                message=f"Bytes received ({bytes_received}) does not match with"
+                f" content length header ({content_length}), chunk incomplete",
+                offset=offset,
+            )
+        response = jsonify(dict(offset=offset))
+        response.status_code = 200
+        return response
+
+    def _content_range(self, filename):
+        """Return the request's "Content-Range" header, and the length of the
+        byte range it describes.
+        """
+        content_range = parse_content_range_header(request.headers.get("Content-Range"))
+        if content_range is None or content_range.units != "bytes":
+            self.logger.debug(
+                f"Tarfile upload: Invalid Content-Range header for file {filename}"
+            )
+            abort(400, message="Missing or invalid Content-Range header")
+        if content_range.stop > self.max_content_length:
+            abort(
+                400,
+                message=f"Payload body too large, {content_range.stop:d} bytes,"
+                " maximum size should be less than or equal to"
+                f" {humanize.naturalsize(self.max_content_length)}",
+            )
+        content_length = content_range.stop - content_range.start
+        if request.content_length != content_length:
+            abort(
+                400,
+                message=f"Content-Length ({request.content_length}) does not match"
+                f" with Content-Range ({content_length} bytes)",
+            )
+        return content_range, content_length
+
+    def _start(self, controller):
+        username = self._username()
+        filename, md5sum = self._file_headers()
+
+        now = time.time()
+        if self.session_max_age and now - self._last_expiry > self.expiry_interval:
+            UploadSession._last_expiry = now
+            self._expire(now - self.session_max_age)
+
+        created = self._create_dataset(username, controller, filename, md5sum)
+        if created is None:
+            session_id = self._find_session(username, controller, filename, md5sum)
+            if session_id is not None:
+                self.logger.info(
+                    "Resuming upload session {} of {}", session_id, filename
+                )
+                response = jsonify(
+                    dict(message="Upload session resumed", session_id=session_id)
+                )
+                response.status_code = 200
+                return response
+            return self._exists(controller, filename)
+        dataset = created[0]
+
+        session_id = uuid.uuid4().hex
+        session_dir = self.upload_directory / self.sessions_dir_name / session_id
+        try:
+            session_dir.mkdir(parents=True)
+            (session_dir / filename).touch()
+            with (session_dir / self.session_file_name).open("w") as fp:
+                json.dump(
+                    dict(
+                        owner=username,
+                        controller=controller,
+                        filename=filename,
+                        md5=md5sum,
+                    ),
+                    fp,
+                )
+        except Exception:
+            self.logger.exception("Unable to create upload session for {}", dataset)
+            shutil.rmtree(session_dir, ignore_errors=True)
+            abort(HTTPStatus.INTERNAL_SERVER_ERROR, message="INTERNAL ERROR")
+
+        self.logger.info(
+            "Uploading file {} to {} in session {}", filename, dataset, session_id
+        )
+        response = jsonify(
+            dict(message="Upload session started", session_id=session_id)
+        )
+        response.status_code = 201
+        return response
+
+    def _commit(self, controller, session_id):
+        session_dir, session = self._session(controller, session_id)
+        filename = session["filename"]
+        md5sum = session["md5"]
+        tmp_name = session_dir / filename
+
+        with tmp_name.open("ab") as ofp:
+            try:
+                fcntl.flock(ofp, fcntl.LOCK_EX | fcntl.LOCK_NB)
+            except BlockingIOError:
+                abort(
+                    HTTPStatus.CONFLICT,
+                    message=f"Another chunk of {filename} is being uploaded",
+                )
+            path = self.upload_directory / controller
+            tar_full_path = Path(path, filename)
+            md5_full_path = Path(path, f"{filename}.md5")
+            if self._linked(tmp_name, tar_full_path):
+                # An earlier commit linked the tar ball into place, but did
+                # not get to finish its dataset.
+                self.logger.info("Tar ball {} is already in place", tar_full_path)
+            else:
+                if self._staged_parts(session_dir):
+                    size, digest = self._assemble(session_dir, ofp, filename)
+                else:
+                    size, digest = md5sum_file(tmp_name)
+                if size == 0:
+                    abort(400, message="Upload failed, no data received")
+                if digest != md5sum:
+                    self.logger.debug(
+                        f"Tarfile upload: md5sum check failed for file {filename}"
+                    )
+                    # The data received is useless, start over from offset 0.
+                    ofp.truncate(0)
+                    shutil.rmtree(session_dir / self.parts_dir_name, ignore_errors=True)
+                    abort(
+                        400,
+                        message=f"md5sum check failed for {filename}, upload failed",
+                        offset=0,
+                    )
+                self._link_into_place(
+                    tmp_name, tar_full_path, md5_full_path, md5sum, filename
+                )
+
+        try:
+            self._finish(tar_full_path, md5sum)
+        except Exception:
+            self.logger.exception("Unable to finalize {}", tar_full_path)
+            abort(HTTPStatus.INTERNAL_SERVER_ERROR, message="INTERNAL ERROR")
+        shutil.rmtree(session_dir, ignore_errors=True)
+        response = jsonify(dict(message="File successfully uploaded"))
+        response.status_code = 201
+        return response
+
+    @staticmethod
+    def _linked(tmp_name, tar_full_path):
+        """Return whether the data file of a session was linked into place,
+        as the given tar ball, or under any other name (e.g. once the tar
+        ball was moved out of the receive directory).
+        """
+        try:
+            return os.path.samefile(tmp_name, tar_full_path) or (
+                tmp_name.stat().st_nlink > 1
+            )
+        except FileNotFoundError:
+            return tmp_name.stat().st_nlink > 1
+
+    def _finish(self, tar_full_path, md5sum):
+        """Advance the dataset of the tar ball linked into place to UPLOADED,
+        unless an earlier attempt already did.
+        """
+        dataset = Dataset.attach(path=tar_full_path)
+        if dataset.state == States.UPLOADING:
+            self.fingerprints.record(tar_full_path, md5sum, dataset)
+            dataset.advance(States.UPLOADED)
+        if self.work_queue and dataset.state == States.UPLOADED:
+            WorkQueue.enqueue(dataset, self.logger)
+
+    def _sessions(self):
+        """Yield the staging directory and description of each upload
+        session, the description being None when it cannot be read.
+        """
+        try:
+            session_dirs = list(
+                (self.upload_directory / self.sessions_dir_name).iterdir()
+            )
+        except FileNotFoundError:
+            return
+        for session_dir in session_dirs:
+            try:
+                with (session_dir / self.session_file_name).open() as fp:
+                    session = json.load(fp)
+            except (OSError, ValueError):
+                session = None
+            yield session_dir, session
+
+    def _find_session(self, username, controller, filename, md5sum):
+        """Return the ID of the session of the given user uploading the given
+        tar ball, or None if there is none.
+        """
+        for session_dir, session in self._sessions():
+            if session == dict(
+                owner=username, controller=controller, filename=filename, md5=md5sum
+            ):
+                return session_dir.name
+        return None
+
+    def _expire(self, cutoff):
+        """Remove the sessions without activity since the given time, and the
+        datasets still UPLOADING since then, which are no longer being
+        uploaded, so that their tar balls can be uploaded again.
+
+        The dataset of a session whose tar ball was linked into place is
+        finished instead.
+        """
+        live = set()
+        for session_dir, session in self._sessions():
+            try:
+                mtimes = [session_dir.stat().st_mtime]
+                mtimes.extend(p.stat().st_mtime for p in session_dir.iterdir())
+                parts_dir = session_dir / self.parts_dir_name
+                if parts_dir.is_dir():
+                    mtimes.extend(p.stat().st_mtime for p in parts_dir.iterdir())
+            except FileNotFoundError:
+                # Committed meanwhile.
+                continue
+            if max(mtimes) >= cutoff:
+                if session is not None:
+                    live.add((session["controller"], session["filename"]))
+                continue
+            if session is not None:
+                if not self._expire_session(session_dir, session):
+                    live.add((session["controller"], session["filename"]))
+                    continue
+            self.logger.info("Removing abandoned upload session {}", session_dir)
+            shutil.rmtree(session_dir, ignore_errors=True)
+
+        try:
+            stale = (
+                Database.db_session.query(Dataset)
+                .filter(Dataset.state == States.UPLOADING)
+                .filter(Dataset.transition < datetime.datetime.fromtimestamp(cutoff))
+                .all()
+            )
+        except Exception:
+            self.logger.exception("Unable to query the stale UPLOADING datasets")
+            return
+        for dataset in stale:
+            filename = f"{dataset.name}.tar.xz"
+            if (dataset.controller, filename) in live:
+                continue
+            if os.path.lexists(self.upload_directory / dataset.controller / filename):
+                # Left for pbench-server-prep-shim-002.
+                continue
+            self.logger.info("Removing abandoned upload of {}", dataset)
+            try:
+                dataset.delete()
+            except Exception:
+                self.logger.exception("Unable to remove {}", dataset)
+
+    def _expire_session(self, session_dir, session):
+        """Remove the dataset of the given abandoned session, or finish it if
+        its tar ball was linked into place, returning False if the session is
+        in use after all.
+        """
+        tmp_name = session_dir / session["filename"]
+        tar_full_path = Path(
+            self.upload_directory, session["controller"], session["filename"]
+        )
+        try:
+            with tmp_name.open("ab") as ofp:
+                try:
+                    fcntl.flock(ofp, fcntl.LOCK_EX | fcntl.LOCK_NB)
+                except BlockingIOError:
+                    return False
+                if self._linked(tmp_name, tar_full_path):
+                    self._finish(tar_full_path, session["md5"])
+                    return True
+                dataset = Dataset.attach(path=tar_full_path)
+                if dataset.state == States.UPLOADING:
+                    self.logger.info("Removing abandoned upload of {}", dataset)
+                    dataset.delete()
+        except Exception:
+            self.logger.exception("Unable to clean up upload session {}", session_dir)
+        return True
+
+    def _staged_parts(self, session_dir):
+        """Return the (first, stop, total) byte ranges of the parts staged for
+        the given session, ordered by their first byte.
+        """
+        try:
+            names = os.listdir(session_dir / self.parts_dir_name)
+        except FileNotFoundError:
+            return []
+        parts = []
+        for name in names:
+            m = self._part_name_pat.fullmatch(name)
+            if m:
+                parts.append(tuple(int(val) for val in m.groups()))
+        return sorted(parts)
+
+    def _assemble(self, session_dir, ofp, filename):
+        """Write the staged parts of the tar ball to the given file, one after
+        the other, returning its size and MD5.
+        """
+        parts = self._staged_parts(session_dir)
+        size = 0
+        total = parts[0][2]
+        for first, stop, part_total in parts:
+            if first != size or part_total != total:
+                abort(
+                    400,
+                    message=f"Parts of {filename} overlap or are missing,"
+                    f" expected a part starting at byte {size:d}",
+                )
+            size = stop
+        if size != total:
+            abort(
+                400,
+                message=f"Parts of {filename} are missing, received {size:d}"
+                f" of {total:d} bytes",
+            )
+
+        parts_dir = session_dir / self.parts_dir_name
+        hash_md5 = hashlib.md5()
+        ofp.truncate(0)
+        for part in parts:
+            with (parts_dir / self.part_name_fmt.format(*part)).open("rb") as ifp:
+                while True:
+                    buf = ifp.read(self.assembly_block_size)
+                    if not buf:
+                        break
+                    ofp.write(buf)
+                    hash_md5.update(buf)
+        ofp.flush()
+        return size, hash_md5.hexdigest()
+
+    def _session(self, controller, session_id):
+        """Return the staging directory and description of the given upload
+        session of the current user.
+        """
+        username = self._username()
+        session_dir = self.upload_directory / self.sessions_dir_name / session_id
+        try:
+            if not self._session_id_pat.fullmatch(session_id):
+                raise FileNotFoundError(session_id)
+            with (session_dir / self.session_file_name).open() as fp:
+                session = json.load(fp)
+        except FileNotFoundError:
+            session = None
+        if session is None or session["controller"] != controller:
+            abort(HTTPStatus.NOT_FOUND, message="No such upload session")
+        if session["owner"] != username:
+            abort(HTTPStatus.FORBIDDEN, message="Upload session owned by another user")
+        return session_dir, session
+
+
+class UploadPart(UploadSession):
+    """A part of a tar ball uploaded within an upload session, so that large
+    tar balls can be sent over several connections at once.
+
+        PUT <uri>/upload/session/<controller>/<session_id>/part
+            Stage a part, described by a "Content-Range: bytes
+            <first>-<last>/<total>" header.
+
+    Parts may be sent in any order, and concurrently; a part sent again
+    replaces the earlier copy.  Committing the session assembles the parts
+    with one sequential write of the tar ball, computing its MD5 as it goes.
+    """
+
+    @Auth.token_auth.login_required()
+    def put(self, controller, session_id):
+        session_dir, session = self._session(controller, session_id)
+        filename = session["filename"]
+
+        content_range, content_length = self._content_range(filename)
+        if content_range.length is None:
+            abort(400, message="Content-Range header must give the total size")
+
+        parts_dir = session_dir / self.parts_dir_name
+        part_name = self.part_name_fmt.format(
+            content_range.start, content_range.stop, content_range.length
+        )
+        parts_dir.mkdir(exist_ok=True)
+        fd, tmp_name = tempfile.mkstemp(dir=parts_dir)
+        try:
+            with os.fdopen(fd, "wb") as ofp:
+                self._preallocate(ofp, content_length)
+                try:
+                    bytes_received = self._receive(ofp, content_length)
+                except Exception:
+                    self.logger.exception(
+                        "Tarfile upload: There was something wrong uploading {}",
+                        filename,
+                    )
+                    abort(
+                        500, message=f"There was something wrong uploading {filename}"
+                    )
+            if bytes_received != content_length:
+                abort(
+                    400,
+                    message=f"Bytes received ({bytes_received}) does not match"
+                    f" with content length header ({content_length}),"
+                    " part incomplete",
+                )
+            os.replace(tmp_name, parts_dir / part_name)
+        except Exception:
+            try:
+                os.remove(tmp_name)
+            except FileNotFoundError:
+                pass
+            raise
+        response = jsonify(dict(first=content_range.start, stop=content_range.stop))
+        response.status_code = 200
+        return response
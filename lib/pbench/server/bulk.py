@@ -0,0 +1,248 @@
+"""Concurrent, adaptive bulk indexing.
+
+An alternative to pyesbulk.streaming_bulk() which keeps a number of bulk
+requests in flight at once, instead of just one, fed from a bounded number of
+batches of actions taken from the generator of actions.
+
+The number of actions in each bulk request adapts to how the cluster is
+keeping up: it grows while requests complete within the target latency, and
+shrinks when they take longer, or when the cluster rejects actions or whole
+requests because it is too busy (HTTP status 429), in which case we also back
+off before sending further requests.  Rejected actions, and the actions of
+requests that time out or cannot reach the cluster, are retried, up to
+_MAX_RETRIES times each, before they are reported as failures.
+
+Successes, duplicates, failures, and retries are counted the same way as by
+pyesbulk.streaming_bulk(), with the actions that failed for good reported to
+the given errors file, one JSON document per line.
+"""
+
+import json
+import time
+from collections import deque
+from concurrent.futures import FIRST_COMPLETED, ThreadPoolExecutor, wait
+from random import SystemRandom
+
+from elasticsearch import ConnectionError as EsConnectionError, TransportError
+
+
+# Number of actions in the first bulk request, and by how much the number
+# grows after each request that completes within the target latency, within
+# the given bounds.
+_INITIAL_BATCH_ACTIONS = 500
+_BATCH_ACTIONS_STEP = 100
+_MIN_BATCH_ACTIONS = 10
+_MAX_BATCH_ACTIONS = 10000
+
+# Bulk requests are kept well below the default Elasticsearch maximum HTTP
+# request size (100 MB).
+_MAX_BATCH_BYTES = 16 * 1024 * 1024
+
+# Request level statuses for which the whole request is retried.
+_RETRY_STATUSES = frozenset((429, 502, 503, 504))
+
+# Number of times an action is retried before it is reported as a failure,
+# so that an unreachable cluster does not keep us retrying forever.
+_MAX_RETRIES = 10
+
+_r = SystemRandom()
+_MAX_SLEEP_TIME = 120
+
+
+class _BulkState:
+    """The counters and retry queue shared by the request completion
+    handling, along with the adaptive batch size and back off delay.
+    """
+
+    def __init__(self, errorsfp, logger, target_latency):
+        self.errorsfp = errorsfp
+        self.logger = logger
+        self.target_latency = target_latency
+        self.successes = 0
+        self.duplicates = 0
+        self.failures = 0
+        self.retries = 0
+        # Actions to be sent again, as (retry count, action, encoded lines).
+        self.retry_q = deque()
+        self.batch_actions = _INITIAL_BATCH_ACTIONS
+        # Back off delay (seconds), and whether to wait before sending the
+        # next request.
+        self.backoff = 0
+        self.paused = False
+
+    def report_failure(self, action, resp, retry_count):
+        self.failures += 1
+        print(
+            json.dumps(
+                dict(action=action, resp=resp, retry_count=retry_count),
+                sort_keys=True,
+            ),
+            file=self.errorsfp,
+        )
+
+    def retry(self, item, resp):
+        retry_count, action, lines = item
+        if retry_count >= _MAX_RETRIES:
+            self.report_failure(action, resp, retry_count)
+            return
+        self.retries += 1
+        self.retry_q.append((retry_count + 1, action, lines))
+
+    def busy(self):
+        """The cluster is too busy: halve the size of subsequent requests and
+        back off (exponentially) before sending them.
+        """
+        self.batch_actions = max(_MIN_BATCH_ACTIONS, self.batch_actions // 2)
+        self.backoff = min(_MAX_SLEEP_TIME, max(1, self.backoff * 2))
+        self.paused = True
+
+    def completed(self, latency):
+        if latency > self.target_latency:
+            self.batch_actions = max(_MIN_BATCH_ACTIONS, (self.batch_actions * 3) // 4)
+        else:
+            self.batch_actions = min(
+                _MAX_BATCH_ACTIONS, self.batch_actions + _BATCH_ACTIONS_STEP
+            )
+        self.backoff = 0
+
+    def handle_items(self, batch, items, latency):
+        rejected = False
+        for item, resp in zip(batch, items):
+            retry_count, action, _ = item
+            result = resp.get(action["_op_type"], resp)
+            status = result.get("status", 0)
+            if 200 <= status < 300:
+                self.successes += 1
+            elif status == 409:
+                if retry_count == 0:
+                    self.duplicates += 1
+                else:
+                    # An earlier attempt, which timed out, made it.
+                    self.successes += 1
+            elif status == 429:
+                rejected = True
+                self.retry(item, resp)
+            else:
+                self.report_failure(action, resp, retry_count)
+        if rejected:
+            self.busy()
+        else:
+            self.completed(latency)
+
+    def handle_error(self, batch, exc):
+        status = getattr(exc, "status_code", None)
+        resp = dict(status=status, error=str(exc))
+        if isinstance(exc, EsConnectionError) or status in _RETRY_STATUSES:
+            self.logger.warning(
+                "bulk request of {:d} actions failed, will retry: {}", len(batch), exc
+            )
+            for item in batch:
+                self.retry(item, resp)
+            self.busy()
+        elif status == 413 and len(batch) > 1:
+            # Request too large, retry the actions in smaller requests.
+            for item in batch:
+                self.retry(item, resp)
+            self.batch_actions = max(_MIN_BATCH_ACTIONS, len(batch) // 2)
+        else:
+            self.logger.warning(
+                "bulk request of {:d} actions failed: {}", len(batch), exc
+            )
+            for retry_count, action, _ in batch:
+                self.report_failure(action, resp, retry_count)
+
+
+def _encode(action):
+    """Return the bulk request lines for the given action; the source
+    document may already be encoded as a string.
+    """
+    header = {action["_op_type"]: {"_index": action["_index"], "_id": action["_id"]}}
+    source = action["_source"]
+    if not isinstance(source, str):
+        source = json.dumps(source)
+    return "{}\n{}\n".format(json.dumps(header), source)
+
+
+def _send(es, batch, request_timeout):
+    """Send one bulk request for the given batch, returning the latency of
+    the request along with either the items of the response or the error.
+    """
+    body = "".join(lines for _, _, lines in batch)
+    start = time.time()
+    try:
+        resp = es.bulk(body=body, request_timeout=request_timeout)
+    except TransportError as exc:
+        return time.time() - start, None, exc
+    return time.time() - start, resp["items"], None
+
+
+def concurrent_bulk(
+    es, actions, errorsfp, logger, requests, target_latency, request_timeout
+):
+    """Bulk index the given actions keeping up to "requests" bulk requests in
+    flight at once, each of which is expected to complete within
+    "target_latency" seconds, and is abandoned (and retried) after
+    "request_timeout" seconds.
+
+    Returns the same tuple as pyesbulk.streaming_bulk() of (start time, end
+    time, indexed count, duplicate count, failed count, and retries).
+    """
+    state = _BulkState(errorsfp, logger, target_latency)
+    actions = iter(actions)
+    exhausted = False
+
+    def next_batch():
+        nonlocal exhausted
+        batch = []
+        size = 0
+        while len(batch) < state.batch_actions and size < _MAX_BATCH_BYTES:
+            if state.retry_q:
+                item = state.retry_q.popleft()
+            elif exhausted:
+                break
+            else:
+                try:
+                    action = next(actions)
+                except StopIteration:
+                    exhausted = True
+                    break
+                item = (0, action, _encode(action))
+            batch.append(item)
+            size += len(item[2])
+        return batch
+
+    beg = time.time()
+    in_flight = {}
+    with ThreadPoolExecutor(max_workers=requests) as executor:
+        while True:
+            while len(in_flight) < requests:
+                if state.paused:
+                    # Don't pile on while the cluster is busy, wait for the
+                    # requests still in flight first.
+                    if in_flight:
+                        break
+                    time.sleep(_r.uniform(state.backoff / 2, state.backoff))
+                    state.paused = False
+                batch = next_batch()
+                if not batch:
+                    break
+                in_flight[executor.submit(_send, es, batch, request_timeout)] = batch
+            if not in_flight:
+                break
+            done, _ = wait(in_flight, return_when=FIRST_COMPLETED)
+            for future in done:
+                batch = in_flight.pop(future)
+                latency, items, exc = future.result()
+                if exc is not None:
+                    state.handle_error(batch, exc)
+                else:
+                    state.handle_items(batch, items, latency)
+    end = time.time()
+    return (
+        beg,
+        end,
+        state.successes,
+        state.duplicates,
+        state.failures,
+        state.retries,
+    )
@@ -327,9 +327,9 @@ class Dataset(Database.Base):
     # This could be improved when we drop `pbench-server-prep-shim-002`
     # as server `PUT` does not have the same problem.
     md5 = Column(String(255), unique=False, nullable=True)
-    created = Column(DateTime, nullable=False, default=datetime.datetime.now())
+    created = Column(DateTime, nullable=False, default=datetime.datetime.now)
     state = Column(Enum(States), unique=False, nullable=False, default=States.UPLOADING)
-    transition = Column(DateTime, nullable=False, default=datetime.datetime.now())
+    transition = Column(DateTime, nullable=False, default=datetime.datetime.now)
 
     # NOTE: this relationship defines a `dataset` property in `Metadata`
     # that refers to the parent `Dataset` object.
@@ -547,6 +547,7 @@ class Dataset(Database.Base):
             Dataset.logger.exception(
                 "Duplicate dataset {}|{}", self.controller, self.name
             )
+            Database.db_session.rollback()
             raise DatasetDuplicate(self.controller, self.name) from e
         except Exception as e:
             self.logger.exception("Can't add {} to DB", str(self))
@@ -565,6 +566,21 @@ class Dataset(Database.Base):
             Database.db_session.rollback()
             raise DatasetSqlError("updating", self.controller, self.name) from e
 
+    def delete(self):
+        """
+        delete Delete the Dataset object, along with its metadata, from the
+        database.
+        """
+        try:
+            for meta in self.metadatas:
+                Database.db_session.delete(meta)
+            Database.db_session.delete(self)
+            Database.db_session.commit()
+        except Exception as e:
+            self.logger.error("Can't delete {} from DB", str(self))
+            Database.db_session.rollback()
+            raise DatasetSqlError("deleting", self.controller, self.name) from e
+
 
 @event.listens_for(Dataset, "init")
 def path_init(target, args, kwargs):
@@ -608,8 +624,18 @@ class Metadata(Database.Base):
     REINDEX = "REINDEX"
     ARCHIVED = "ARCHIVED"
     TARBALL_PATH = "TARBALL_PATH"
-
-    METADATA_KEYS = [REINDEX, ARCHIVED, TARBALL_PATH]
+    INDEX_CHECKPOINT = "INDEX_CHECKPOINT"
+    TOOL_INDEX_CHECKPOINT = "TOOL_INDEX_CHECKPOINT"
+    FINGERPRINT = "FINGERPRINT"
+
+    METADATA_KEYS = [
+        REINDEX,
+        ARCHIVED,
+        TARBALL_PATH,
+        INDEX_CHECKPOINT,
+        TOOL_INDEX_CHECKPOINT,
+        FINGERPRINT,
+    ]
 
     id = Column(Integer, primary_key=True, autoincrement=True)
     key = Column(String(255), unique=False, nullable=False, index=True)
@@ -747,3 +773,35 @@ def check_required(target, args, kwargs):
         raise MetadataMissingParameter("key")
     if "value" not in kwargs:
         raise MetadataMissingKeyValue(kwargs.get("key"))
+
+
+class WorkItem(Database.Base):
+    """ Queue a dataset for the workers processing datasets in a given state
+    (see pbench.server.work_queue)
+
+    Columns:
+        id          Generated unique ID of table row
+        dataset_ref Dataset row ID (foreign key)
+        state       The state of the dataset the work is keyed by
+        queued      The time the dataset was queued
+        attempts    The number of failed attempts at the work so far
+        ready       The time from which the work may be claimed, later than
+                    the time it was queued after a failed attempt
+    """
+
+    __tablename__ = "work_queue"
+
+    id = Column(Integer, primary_key=True, autoincrement=True)
+    dataset_ref = Column(
+        Integer, ForeignKey("datasets.id", ondelete="CASCADE"), nullable=False
+    )
+    state = Column(Enum(States), unique=False, nullable=False, index=True)
+    queued = Column(DateTime, nullable=False, default=datetime.datetime.now)
+    attempts = Column(Integer, nullable=False, default=0)
+    ready = Column(DateTime, nullable=False, default=datetime.datetime.now)
+
+    # A dataset is queued at most once for each state.
+    __table_args__ = (UniqueConstraint("dataset_ref", "state"), {})
+
+    def __str__(self):
+        return f"{self.dataset_ref}@{self.state}"
@@ -0,0 +1,183 @@
+"""Long-running worker processing the datasets of the work queue.
+
+The worker claims the datasets queued as UPLOADED or UNPACKED (see
+pbench.server.work_queue) and runs the existing stages of the server pipeline
+on the tar ball of each, one tar ball at a time, instead of waiting for the
+cron driven scripts to find it:
+
+    UPLOADED    pbench-server-prep-shim-002 (when the tar ball is still in
+                the reception area), then pbench-dispatch and
+                pbench-unpack-tarballs on its TODO and TO-UNPACK links; the
+                dataset is queued again once UNPACKED
+    UNPACKED    pbench-index on its TO-INDEX link, then pbench-index
+                --tool-data on its TO-INDEX-TOOL link, if any
+
+Each stage maintains the state links of the tar ball as it always has, so the
+symlink tree stays a faithful view of the pipeline, and each is run holding
+the lock of its cron job, so that the cron jobs can keep running alongside
+the workers.  A stage which leaves the link of the tar ball where it was
+(e.g. Elasticsearch was unreachable, or the cron job held the lock for too
+long) is retried later; one which moves it to an error directory is done.
+"""
+
+import subprocess
+from pathlib import Path
+
+from pbench.server.database.database import Database
+from pbench.server.database.models.tracker import Dataset, States
+
+# The Upload API only receives tar balls in the reception area of version
+# 002 agents.
+_SHIM_VERSION = "002"
+
+# How long (seconds) to wait for the lock of a stage, held by its cron job,
+# before retrying the dataset later.
+_LOCK_WAIT = 300
+
+
+class RetryLater(Exception):
+    """The stage run on a tar ball did not get to it."""
+
+
+class DatasetWorker:
+    """Run the stages of the server pipeline on the tar ball of each dataset
+    claimed from the given work queue.
+    """
+
+    states = [States.UPLOADED, States.UNPACKED]
+
+    def __init__(self, config, logger, queue):
+        self.config = config
+        self.logger = logger
+        self.queue = queue
+        self.archive = Path(config.ARCHIVE)
+        self.bindir = Path(config.BINDIR)
+        self.lockdir = Path(config.conf.get("pbench-server", "lock-dir"))
+        self.stages = {States.UPLOADED: self.unpack, States.UNPACKED: self.index}
+
+    def _link(self, dataset, linkdir):
+        """Return the given state link of the dataset's tar ball, or None if
+        there is no such link.
+        """
+        link = self.archive / dataset.controller / linkdir / f"{dataset.name}.tar.xz"
+        return link if link.is_symlink() else None
+
+    def _run(self, *args, locks=()):
+        """Run the given command holding the given locks, those of the cron
+        jobs running the same command.
+        """
+        cmd = [str(self.bindir / args[0]), *args[1:]]
+        for lock in reversed(locks):
+            cmd = ["flock", "-w", str(_LOCK_WAIT), str(self.lockdir / lock), *cmd]
+        self.logger.debug("running {}", " ".join(cmd))
+        sts = subprocess.run(cmd).returncode
+        if sts != 0:
+            self.logger.warning("{} failed: code {:d}", " ".join(cmd), sts)
+
+    def _unpack_locks(self, link):
+        """Return the locks of the pbench-unpack-tarballs cron jobs which
+        would unpack the tar ball of the given link: the one without a size
+        bucket, and the one of the bucket the size of the tar ball falls in.
+        """
+        locks = ["pbench-unpack-tarballs.lock"]
+        try:
+            size = link.stat().st_size
+        except OSError:
+            return locks
+        conf = self.config.conf
+        prefix = "pbench-unpack-tarballs/"
+        for section in conf.sections():
+            if not section.startswith(prefix):
+                continue
+            # Bounds in MB, as used by pbench-unpack-tarballs.
+            lower = conf.getint(section, "lowerbound", fallback=0) * 1024 * 1024
+            upper = conf.getint(section, "upperbound", fallback=None)
+            if lower <= size and (upper is None or size < upper * 1024 * 1024):
+                locks.append(f"pbench-unpack-tarballs-{section[len(prefix):]}.lock")
+        return locks
+
+    def _state(self, dataset):
+        """Return the current state of the dataset, as left by the stage run
+        on its tar ball.
+        """
+        Database.db_session.refresh(dataset)
+        return dataset.state
+
+    def unpack(self, dataset):
+        tb = self.archive / dataset.controller / f"{dataset.name}.tar.xz"
+        if not tb.exists():
+            self._run(
+                f"pbench-server-prep-shim-{_SHIM_VERSION}",
+                locks=[f"pbench-prep-{_SHIM_VERSION}.lock"],
+            )
+        link = self._link(dataset, "TODO")
+        if link is not None:
+            self._run("pbench-dispatch", str(link), locks=["pbench-dispatch.lock"])
+        link = self._link(dataset, "TO-UNPACK")
+        if link is not None:
+            self._run(
+                "pbench-unpack-tarballs", str(link), locks=self._unpack_locks(link)
+            )
+        if (
+            self._link(dataset, "TO-INDEX") is not None
+            or self._state(dataset) == States.UNPACKED
+        ):
+            return States.UNPACKED
+        if not tb.exists():
+            receive_dir = self.config.get("pbench-server", "pbench-receive-dir-prefix")
+            received = Path(
+                f"{receive_dir}-{_SHIM_VERSION}",
+                dataset.controller,
+                f"{dataset.name}.tar.xz",
+            )
+            if received.exists():
+                raise RetryLater(f"{received} is still in the reception area")
+        for linkdir in ("TODO", "TO-UNPACK"):
+            if self._link(dataset, linkdir) is not None:
+                raise RetryLater(f"{dataset} is still in {linkdir}")
+        self.logger.warning(
+            "{} was not unpacked, its state is {}", dataset, dataset.state
+        )
+        return None
+
+    def index(self, dataset):
+        link = self._link(dataset, "TO-INDEX")
+        if link is not None:
+            self._run("pbench-index", str(link), locks=["pbench-index.lock"])
+        link = self._link(dataset, "TO-INDEX-TOOL")
+        if link is not None:
+            self._run(
+                "pbench-index",
+                "--tool-data",
+                str(link),
+                locks=["pbench-index-tool-data.lock"],
+            )
+        for linkdir in ("TO-INDEX", "TO-INDEX-TOOL"):
+            if self._link(dataset, linkdir) is not None:
+                raise RetryLater(f"{dataset} is still in {linkdir}")
+        return None
+
+    def process_one(self):
+        """Claim one queued dataset and run the stages for its state,
+        returning False if there was none to claim.
+
+        The dataset is queued for its next state when done; when the stages
+        did not get to its tar ball, it is retried later.
+        """
+        item = self.queue.claim()
+        if item is None:
+            return False
+        try:
+            dataset = Database.db_session.query(Dataset).get(item.dataset_ref)
+            self.logger.info("processing {} ({})", dataset, item.state)
+            next_state = self.stages[item.state](dataset)
+        except RetryLater as e:
+            self.logger.warning("Retrying work item {} later: {}", item, e)
+            self.queue.retry(item)
+        except Exception:
+            self.logger.exception("Failed to process work item {}", item)
+            self.queue.retry(item)
+        else:
+            self.queue.done(item, next_state)
+        Database.db_session.remove()
+        return True
@@ -0,0 +1,146 @@
+"""Verified checksum fingerprints of tar balls.
+
+Once the MD5 sum of a tar ball has been verified, its fingerprint, the MD5
+sum along with the size, mtime (ns) and inode of the file, is recorded as the
+FINGERPRINT metadata of the tar ball's Dataset.  The later stages of the
+server pipeline trust the recorded MD5 sum instead of reading the whole tar
+ball again to compute it, as long as the size, mtime and inode of the tar
+ball still match, and the fingerprint was verified less than the scrub
+interval ago.  Otherwise the MD5 sum is computed in full, and the
+fingerprint recorded anew when it matches.
+
+Renaming a tar ball within a file system keeps its inode, so a fingerprint
+survives the move of the tar ball into the archive; a copy to another file
+system does not, and the next stage computes the MD5 sum again.
+
+This is enabled with "checksum-fingerprints = yes" in the "pbench-server"
+section of the configuration, and fingerprints are verified again in full
+every "checksum-scrub-days" days (default 30, 0 to never trust them).
+"""
+
+import json
+import os
+import time
+
+from pbench.common.utils import md5sum
+from pbench.server.database.models.tracker import (
+    Dataset,
+    DatasetError,
+    Metadata,
+    MetadataNotFound,
+)
+
+DEFAULT_SCRUB_DAYS = 30
+
+
+class Fingerprints:
+    """Record and check the FINGERPRINT metadata of the Datasets of tar
+    balls, per the configuration given.
+    """
+
+    def __init__(self, config, logger):
+        self.logger = logger
+        try:
+            self.enabled = config.conf.getboolean(
+                "pbench-server", "checksum-fingerprints", fallback=False
+            )
+            scrub_days = config.conf.getint(
+                "pbench-server", "checksum-scrub-days", fallback=DEFAULT_SCRUB_DAYS
+            )
+        except ValueError as e:
+            self.logger.warning("Checksum fingerprints disabled, bad config: {}", e)
+            self.enabled = False
+            scrub_days = 0
+        self.scrub_secs = max(0, scrub_days) * 24 * 60 * 60
+
+    @staticmethod
+    def _identity(st):
+        return dict(size=st.st_size, mtime_ns=st.st_mtime_ns, inode=st.st_ino)
+
+    def _dataset(self, path, dataset):
+        if dataset is not None:
+            return dataset
+        try:
+            return Dataset.attach(path=path)
+        except DatasetError as e:
+            self.logger.warning("No fingerprint for {}: {}", path, e)
+            return None
+
+    def _trusted(self, dataset, st, expected_md5):
+        """Return True if the fingerprint recorded for the Dataset vouches for
+        the expected MD5 sum of the tar ball with the given stat result.
+        """
+        try:
+            fingerprint = json.loads(Metadata.get(dataset, Metadata.FINGERPRINT).value)
+        except MetadataNotFound:
+            return False
+        except (DatasetError, ValueError, TypeError) as e:
+            self.logger.warning("Unable to get the fingerprint of {}: {}", dataset, e)
+            return False
+        try:
+            return (
+                fingerprint["md5"] == expected_md5
+                and all(fingerprint[k] == v for k, v in self._identity(st).items())
+                and time.time() - fingerprint["verified"] < self.scrub_secs
+            )
+        except (KeyError, TypeError):
+            return False
+
+    def _record(self, dataset, st, md5):
+        """Record the fingerprint of the tar ball with the given stat result,
+        verified now.  Failing to do so is not fatal, as it only means the
+        MD5 sum is computed again by the next stage.
+        """
+        value = json.dumps(
+            dict(md5=md5, verified=int(time.time()), **self._identity(st))
+        )
+        try:
+            try:
+                meta = Metadata.get(dataset, Metadata.FINGERPRINT)
+            except MetadataNotFound:
+                Metadata.create(dataset=dataset, key=Metadata.FINGERPRINT, value=value)
+            else:
+                meta.value = value
+                meta.update()
+        except DatasetError as e:
+            self.logger.warning(
+                "Unable to record the fingerprint of {}: {}", dataset, e
+            )
+
+    def record(self, path, md5, dataset=None):
+        """Record the fingerprint of the tar ball at the given path, whose MD5
+        sum was just verified to be the one given.
+        """
+        if not self.enabled:
+            return
+        dataset = self._dataset(path, dataset)
+        if dataset is None:
+            return
+        try:
+            st = os.stat(path)
+        except OSError as e:
+            self.logger.warning("Unable to fingerprint {}: {}", path, e)
+            return
+        self._record(dataset, st, md5)
+
+    def md5(self, path, expected_md5, dataset=None):
+        """Return the MD5 sum of the tar ball at the given path, for the caller
+        to check against the expected one (that of its ".md5" file, None if
+        unknown).
+
+        The expected MD5 sum is returned as is when the tar ball's fingerprint
+        vouches for it; otherwise the MD5 sum is computed, and the fingerprint
+        recorded when it matches.  Errors reading the tar ball are raised as
+        they are by md5sum().
+        """
+        if not self.enabled or expected_md5 is None:
+            return md5sum(path)[1]
+        dataset = self._dataset(path, dataset)
+        st = os.stat(path)
+        if dataset is not None and self._trusted(dataset, st, expected_md5):
+            self.logger.debug("Trusting the fingerprint of {}", path)
+            return expected_md5
+        computed = md5sum(path)[1]
+        if dataset is not None and computed == expected_md5:
+            self._record(dataset, st, computed)
+        return computed
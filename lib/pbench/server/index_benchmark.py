@@ -0,0 +1,323 @@
+"""Indexing benchmark.
+
+Generate a synthetic pbench tar ball of a given shape, and measure how fast
+the indexer generates the actions for all of its documents, both for the run
+and result data (PbenchTarBall.make_all_actions()) and the tool data
+(PbenchTarBall.mk_tool_data_actions()), handing them to a sink which only
+counts them and the size of the bulk requests they make up, instead of to
+Elasticsearch.
+
+The report gives the documents and bytes per second, the peak RSS, and the
+time spent generating the documents of each index template.  Run it via
+"pbench-index --benchmark [<shape>]", where the shape is a comma separated
+list of <key>=<value> pairs overriding the defaults of BenchmarkShape.
+"""
+
+import hashlib
+import os
+import random
+import resource
+import shutil
+import sys
+import tarfile
+import tempfile
+import time
+from collections import Counter
+from datetime import datetime, timedelta
+
+from pbench.server.indexer import PbenchTarBall
+from pbench.server.mock import MockBulkSink
+
+
+# The synthetic tool data, by tool, as a list of (file name, columns) for
+# each file of the tool, where "{}" in a file or column name is replaced by
+# the number of each of the "columns" of the shape (e.g. disks or CPUs).
+_SYNTHETIC_TOOLS = {
+    "iostat": [
+        ("disk_IOPS.csv", ["disk{}-read", "disk{}-write"]),
+        ("disk_Queue_Size.csv", ["disk{}"]),
+        ("disk_Throughput_MB_per_sec.csv", ["disk{}-read", "disk{}-write"]),
+    ],
+    "mpstat": [
+        (
+            "cpu{}_cpu{}.csv",
+            [
+                "guest",
+                "idle",
+                "iowait",
+                "irq",
+                "nice",
+                "softirq",
+                "steal",
+                "sys",
+                "usr",
+            ],
+        ),
+    ],
+    "vmstat": [
+        ("vmstat_cpu.csv", ["idle", "steal", "sys", "user", "wait"]),
+        (
+            "vmstat_memory.csv",
+            ["active_KiB", "free_KiB", "inactive_KiB", "swapped_KiB"],
+        ),
+        ("vmstat_procs.csv", ["blocked", "running"]),
+        ("vmstat_system.csv", ["cntx_switches", "interrupts"]),
+    ],
+}
+
+_CONTROLLER = "bench-controller"
+_START_RUN = datetime(2021, 1, 1, 0, 0, 0)
+
+
+class BenchmarkShape:
+    """The shape of a synthetic tar ball: the number of iterations, samples
+    per iteration, hosts, and tools per host (iostat, mpstat, and vmstat, in
+    that order), the number of disks or CPUs ("columns") per tool, the
+    number of rows of each tool data .csv file (one per second), and the
+    number of additional small files per host, in a "sysinfo" tree of 100
+    files per directory, which only add to the table-of-contents documents.
+
+    Large numbers of files make the table-of-contents the dominant part of
+    the peak RSS reported.
+    """
+
+    _keys = ("iterations", "samples", "hosts", "tools", "columns", "rows", "files")
+
+    def __init__(
+        self, iterations=2, samples=2, hosts=2, tools=3, columns=8, rows=600, files=0
+    ):
+        self.iterations = iterations
+        self.samples = samples
+        self.hosts = hosts
+        self.tools = tools
+        self.columns = columns
+        self.rows = rows
+        self.files = files
+        for key in self._keys:
+            minimum = 0 if key == "files" else 1
+            if getattr(self, key) < minimum:
+                raise ValueError(f"benchmark {key} must be at least {minimum:d}")
+        if tools > len(_SYNTHETIC_TOOLS):
+            raise ValueError(
+                f"benchmark tools must be at most {len(_SYNTHETIC_TOOLS):d}"
+            )
+
+    @classmethod
+    def parse(cls, spec):
+        """Return the shape given by the "<key>=<value>,..." string."""
+        kwargs = {}
+        for item in filter(None, spec.split(",")):
+            key, sep, val = item.partition("=")
+            key = key.strip()
+            if not sep or key not in cls._keys:
+                raise ValueError(
+                    f"invalid benchmark shape item, '{item}', expected"
+                    f" <key>=<value> with one of the keys {', '.join(cls._keys)}"
+                )
+            try:
+                kwargs[key] = int(val)
+            except ValueError:
+                raise ValueError(f"benchmark {key}, '{val}', is not an integer")
+        return cls(**kwargs)
+
+    def __str__(self):
+        return ",".join(f"{key}={getattr(self, key):d}" for key in self._keys)
+
+
+def make_tarball(shape, root):
+    """Generate a synthetic tar ball of the given shape under the given root
+    directory, both unpacked, in "<root>/incoming/<controller>", and as a tar
+    ball (along with its .md5 file) in "<root>/archive/<controller>".
+
+    Returns a tuple of the path of the tar ball and its unpacked directory.
+    """
+    rng = random.Random(42)
+    name = "pbench-user-benchmark_synthetic_{}".format(
+        _START_RUN.strftime("%Y.%m.%dT%H.%M.%S")
+    )
+    extracted_root = os.path.join(root, "incoming", _CONTROLLER)
+    tb_dir = os.path.join(extracted_root, name)
+    iterations = [f"{i:d}-synthetic" for i in range(1, shape.iterations + 1)]
+    hosts = [f"host{h:d}.example.com" for h in range(shape.hosts)]
+    tools = sorted(_SYNTHETIC_TOOLS)[: shape.tools]
+    start_ms = int((_START_RUN - datetime(1970, 1, 1)).total_seconds()) * 1000
+    end_run = _START_RUN + timedelta(seconds=shape.rows + 1)
+
+    os.makedirs(tb_dir)
+    with open(os.path.join(tb_dir, "metadata.log"), "w") as fp:
+        print("[pbench]", file=fp)
+        print(f"name = {name}", file=fp)
+        print("script = pbench-user-benchmark", file=fp)
+        print("config = synthetic", file=fp)
+        print(f"date = {_START_RUN.isoformat()}", file=fp)
+        print(f"iterations = {', '.join(iterations)}", file=fp)
+        print("\n[tools]", file=fp)
+        print(f"hosts = {' '.join(hosts)}", file=fp)
+        print("group = default", file=fp)
+        for host in hosts:
+            print(f"\n[tools/{host}]", file=fp)
+            print(f"hostname-s = {host.split('.')[0]}", file=fp)
+            for tool in tools:
+                print(f"{tool} = --interval=1", file=fp)
+        print("\n[run]", file=fp)
+        print(f"controller = {_CONTROLLER}", file=fp)
+        print(f"start_run = {_START_RUN.isoformat()}.000000", file=fp)
+        print(f"end_run = {end_run.isoformat()}.000000", file=fp)
+
+    for iteration in iterations:
+        for s in range(1, shape.samples + 1):
+            for host in hosts:
+                for tool in tools:
+                    csv_dir = os.path.join(
+                        tb_dir,
+                        iteration,
+                        f"sample{s:d}",
+                        "tools-default",
+                        host,
+                        tool,
+                        "csv",
+                    )
+                    os.makedirs(csv_dir)
+                    for fname, columns in _mk_tool_files(tool, shape.columns):
+                        with open(os.path.join(csv_dir, fname), "w") as fp:
+                            print(",".join(["timestamp_ms"] + columns), file=fp)
+                            for row in range(shape.rows):
+                                # Integer values suit the converters of all
+                                # the tools.
+                                vals = [str(rng.randrange(100)) for _ in columns]
+                                ts = start_ms + (row + 1) * 1000
+                                print(",".join([str(ts)] + vals), file=fp)
+
+    for host in hosts:
+        for f in range(shape.files):
+            sysinfo_dir = os.path.join(
+                tb_dir, "sysinfo", "end", host, f"dir{f // 100:d}"
+            )
+            if f % 100 == 0:
+                os.makedirs(sysinfo_dir)
+            with open(os.path.join(sysinfo_dir, f"file{f:d}"), "w") as fp:
+                print(f"synthetic file {f:d}", file=fp)
+
+    archive_dir = os.path.join(root, "archive", _CONTROLLER)
+    os.makedirs(archive_dir)
+    tb_path = os.path.join(archive_dir, f"{name}.tar.xz")
+    with tarfile.open(tb_path, "w:xz") as tb:
+
+        def forget(tarinfo):
+            # Don't keep the TarInfo objects of all the members, so that the
+            # peak RSS reported is that of indexing the tar ball rather than
+            # of generating it.
+            tb.members.clear()
+            return tarinfo
+
+        tb.add(tb_dir, arcname=name, filter=forget)
+    md5 = hashlib.md5()
+    with open(tb_path, "rb") as fp:
+        for chunk in iter(lambda: fp.read(1024 * 1024), b""):
+            md5.update(chunk)
+    with open(f"{tb_path}.md5", "w") as fp:
+        print(f"{md5.hexdigest()}  {name}.tar.xz", file=fp)
+    return tb_path, extracted_root
+
+
+def _mk_tool_files(tool, ncolumns):
+    """Return the (file name, columns) of each .csv file of the given tool."""
+    files = []
+    for fname, columns in _SYNTHETIC_TOOLS[tool]:
+        if "{}" in fname:
+            for n in range(ncolumns):
+                files.append((fname.format(n, n), columns))
+        elif any("{}" in col for col in columns):
+            files.append(
+                (fname, [col.format(n) for n in range(ncolumns) for col in columns])
+            )
+        else:
+            files.append((fname, columns))
+    return files
+
+
+def _drain(actions, sink, phase_times):
+    """Hand all the given actions to the sink, adding the time spent
+    generating the actions of each index template to "phase_times".
+    """
+    actions = iter(actions)
+    phase = None
+    while True:
+        start = time.perf_counter()
+        try:
+            action = next(actions)
+        except StopIteration:
+            if phase is not None:
+                phase_times[phase] += time.perf_counter() - start
+            return
+        # Index names are "<prefix>.v<version>.<template>[.<date>]".
+        phase = action["_index"].split(".")[2]
+        phase_times[phase] += time.perf_counter() - start
+        start = time.perf_counter()
+        sink.index(action)
+        phase_times["(sink)"] += time.perf_counter() - start
+
+
+def run_benchmark(idxctx, shape, out=sys.stdout):
+    """Run the indexing benchmark for a tar ball of the given shape, using
+    the given indexing context, and report the results to "out".
+
+    Returns a dictionary of the results.
+    """
+    if idxctx.get_tracking_id() is None:
+        idxctx.set_tracking_id("benchmark")
+    root = tempfile.mkdtemp(prefix="pbench-index-benchmark.", dir=idxctx.config.TMP)
+    try:
+        start = time.perf_counter()
+        tb_path, extracted_root = make_tarball(shape, root)
+        gen_time = time.perf_counter() - start
+
+        sink = MockBulkSink()
+        phase_times = Counter()
+        start = time.perf_counter()
+        ptb = PbenchTarBall(idxctx, None, tb_path, root, extracted_root)
+        phase_times["(open)"] += time.perf_counter() - start
+        _drain(ptb.make_all_actions(), sink, phase_times)
+        _drain(ptb.mk_tool_data_actions(), sink, phase_times)
+        elapsed = time.perf_counter() - start
+        tb_size = os.path.getsize(tb_path)
+    finally:
+        shutil.rmtree(root, ignore_errors=True)
+
+    # On Linux, ru_maxrss is in KiB.
+    rss_self = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    rss_children = resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss
+    docs = sum(sink.docs.values())
+    nbytes = sum(sink.bytes.values())
+    results = dict(
+        shape=str(shape),
+        tarball_size=tb_size,
+        generate_secs=gen_time,
+        docs=docs,
+        bytes=nbytes,
+        secs=elapsed,
+        docs_per_sec=docs / elapsed,
+        bytes_per_sec=nbytes / elapsed,
+        peak_rss_kib=rss_self,
+        peak_rss_children_kib=rss_children,
+        phases=dict(phase_times),
+    )
+
+    print(f"shape: {shape}", file=out)
+    print(
+        f"synthetic tar ball: {tb_size:d} bytes, generated in {gen_time:.2f}s",
+        file=out,
+    )
+    for phase in sorted(phase_times):
+        print(f"  {phase:<32} {phase_times[phase]:10.3f}s", file=out)
+    print(
+        f"total: {docs:d} docs, {nbytes:d} bytes in {elapsed:.3f}s"
+        f" ({docs / elapsed:.1f} docs/sec, {nbytes / elapsed:.1f} bytes/sec)",
+        file=out,
+    )
+    print(
+        f"peak RSS: {rss_self / 1024:.1f} MiB"
+        f" (children {rss_children / 1024:.1f} MiB)",
+        file=out,
+    )
+    return results
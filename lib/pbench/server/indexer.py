@@ -2,21 +2,30 @@
 result tar balls.
 """
 
+import bisect
 import csv
 import hashlib
 import json
 import logging
 import math
+import multiprocessing
 import os
+import pickle
+import queue
 import re
+import signal
 import socket
+import sys
 import tarfile
+import time
 import errno
-from collections import Counter
+from array import array
+from collections import Counter, defaultdict
 from configparser import ConfigParser
 from configparser import Error as ConfigParserError
 from configparser import NoOptionError, NoSectionError
 from datetime import datetime, timedelta
+from itertools import islice
 from operator import itemgetter
 from random import SystemRandom
 from time import sleep as _sleep
@@ -35,6 +44,13 @@ from pbench.common.exceptions import (
     BadSampleName,
 )
 from pbench.common.logger import get_pbench_logger
+from pbench.server.bulk import concurrent_bulk
+from pbench.server.manifest import (
+    ManifestError,
+    list_members,
+    load_manifest,
+    manifest_path,
+)
 from pbench.server.templates import PbenchTemplates
 import pbench.server
 
@@ -89,6 +105,41 @@ _dict_const = dict
 _r = SystemRandom()
 _MAX_SLEEP_TIME = 120
 
+# When generating tool data documents in parallel, each worker sends its
+# documents to the parent in chunks of this many documents, and at most this
+# many chunks per worker can be queued, bounding the memory used by documents
+# waiting to be indexed.
+_TOOL_DATA_CHUNK_SIZE = 1000
+_TOOL_DATA_QUEUE_CHUNKS = 8
+
+# Number of rows read from each .csv file at a time to be processed a column
+# at a time when unifying the data of a tool's .csv files.
+_CSV_BLOCK_ROWS = 1024
+
+# Number of characters read at a time from the stdout files of tools handled
+# by the "periodic_timestamp" method.
+_STDOUT_BLOCK_SIZE = 4 * 1024 * 1024
+
+# Number of characters read at a time from a result.json file when streaming
+# its iterations, see _json_array_items().
+_JSON_BLOCK_SIZE = 1024 * 1024
+
+# Maximum number of normalized timestamps remembered per tool or result data
+# object, see PbenchData.mk_abs_timestamp_millis().
+_TS_MEMO_SIZE = 65536
+
+_EPOCH = datetime(1970, 1, 1)
+
+
+def _std_datetime_str(ts):
+    """Format the given (naive) datetime using the standard normalized format,
+    _STD_DATETIME_FMT, avoiding the cost of strftime() where isoformat()
+    yields the same string (it does not zero pad years before 1000).
+    """
+    if ts.year < 1000:
+        return ts.strftime(_STD_DATETIME_FMT)
+    return ts.isoformat(timespec="microseconds")
+
 
 def _calc_backoff_sleep(backoff):
     global _r
@@ -120,10 +171,14 @@ def _get_es_hosts(config, logger):
     ]
 
 
-def get_es(config, logger):
+def get_es(config, logger, bulk_requests=1):
     """Return an Elasticsearch() object derived from the given configuration.
     If the configuration does not provide the necessary data, we return None
     instead.
+
+    When more than one bulk request is to be kept in flight (see es_index()),
+    the object is given enough connections for them, and compresses request
+    bodies.
     """
     hosts = _get_es_hosts(config, logger)
     if hosts is None:
@@ -145,7 +200,12 @@ def get_es(config, logger):
         # file instead of setting the logging level up so high.
         logging.getLogger("urllib3").setLevel(logging.FATAL)
         logging.getLogger("elasticsearch1").setLevel(logging.FATAL)
-        es = Elasticsearch(hosts, max_retries=0)
+        if bulk_requests > 1:
+            es = Elasticsearch(
+                hosts, max_retries=0, maxsize=bulk_requests, http_compress=True
+            )
+        else:
+            es = Elasticsearch(hosts, max_retries=0)
     return es
 
 
@@ -160,10 +220,24 @@ _read_timeout = 100000 * 60.0
 _request_timeout = 100000 * 60.0
 
 
-def es_index(es, actions, errorsfp, logger, _dbg=0):
+def es_index(
+    es,
+    actions,
+    errorsfp,
+    logger,
+    _dbg=0,
+    bulk_requests=1,
+    bulk_target_latency=None,
+    bulk_request_timeout=None,
+):
     """
     es_index Encapsulate the interface to the pyesbulk module index code.
 
+    When more than one bulk request is to be kept in flight, the actions are
+    instead indexed by pbench.server.bulk.concurrent_bulk(), with batches of
+    actions sized to complete within the target latency (seconds), and each
+    request abandoned (and retried) after the request timeout (seconds).
+
     Args:
         es ([Elasticsearch]): An Elasticsearch object instance from either
             the "elasticsearch1" (Elasticsearch V1) or "elasticsearch"
@@ -171,14 +245,441 @@ def es_index(es, actions, errorsfp, logger, _dbg=0):
         actions ([type]): Elasticsearch bulk index action tuples
         errorsfp ([type]): A file pointer for error reporting
         logger ([type]): Standard logging object for use by bulk indexer
+        bulk_requests (int): Number of bulk requests kept in flight
+        bulk_target_latency (int): Target latency of bulk requests
+        bulk_request_timeout (int): Timeout of bulk requests
 
     Returns:
         tuple of (start time, end time, indexed count, duplicate count, failed
         count, and retries)
     """
+    if bulk_requests > 1:
+        return concurrent_bulk(
+            es,
+            actions,
+            errorsfp,
+            logger,
+            bulk_requests,
+            bulk_target_latency,
+            bulk_request_timeout,
+        )
     return pyesbulk.streaming_bulk(es, actions, errorsfp, logger)
 
 
+class IndexingCheckpoint:
+    """Track which units of the documents of a tar ball (e.g. the tool data
+    of one tool on one host for one sample of an iteration) have been fully
+    indexed, so that indexing an interrupted tar ball can skip them when it
+    is resumed.
+
+    Units are recorded by their position in the list of all the units of the
+    tar ball, along with a digest of that list, so that a checkpoint recorded
+    for a different list is ignored.  A unit is "finished" once all of its
+    actions have been generated, and "done" once all of those actions have
+    been acknowledged by Elasticsearch, see acknowledged().
+    """
+
+    def __init__(self, units, value=None):
+        self._ordinals = {unit: i for i, unit in enumerate(units)}
+        self.digest = hashlib.md5(json.dumps(units).encode("utf-8")).hexdigest()
+        self.done = set()
+        self._finished = []
+        self._failed = False
+        if value:
+            self._decode(value)
+
+    def _decode(self, value):
+        """Load the done units from the given value (see encode()), ignoring
+        a value recorded for a different list of units, or a corrupt one.
+        """
+        digest, _, ranges = value.partition(":")
+        if digest != self.digest or not ranges:
+            return
+        done = set()
+        try:
+            for rng in ranges.split(","):
+                first, _, last = rng.partition("-")
+                done.update(range(int(first), int(last or first) + 1))
+        except ValueError:
+            return
+        self.done = done
+
+    def encode(self, max_len):
+        """Return the done units as a string of at most max_len characters,
+        "<digest>:<first>-<last>,<ordinal>,...".  Only as many ranges as fit
+        are recorded; the units left out are simply indexed again.
+        """
+        value = self.digest + ":"
+        ranges = []
+        for ordinal in sorted(self.done):
+            if ranges and ranges[-1][1] == ordinal - 1:
+                ranges[-1][1] = ordinal
+            else:
+                ranges.append([ordinal, ordinal])
+        sep = ""
+        for first, last in ranges:
+            rng = str(first) if first == last else "{:d}-{:d}".format(first, last)
+            if len(value) + len(sep) + len(rng) > max_len:
+                break
+            value += sep + rng
+            sep = ","
+        return value
+
+    def is_done(self, unit):
+        return self._ordinals.get(unit) in self.done
+
+    def unit_finished(self, unit):
+        self._finished.append(self._ordinals[unit])
+
+    def acknowledged(self, failures=0):
+        """All the actions generated so far have been indexed, with the given
+        number of failures; unless there were none, the finished units are
+        now done.
+
+        We can't tell which units failed actions belong to, and they may be
+        units still being generated, so once any action has failed no more
+        units are done.
+
+        Returns True if any units were newly done.
+        """
+        if failures > 0:
+            self._failed = True
+        if self._failed:
+            self._finished = []
+            return False
+        if not self._finished:
+            return False
+        self.done.update(self._finished)
+        self._finished = []
+        return True
+
+
+class IndexedIds:
+    """The documents of a tar ball acknowledged by Elasticsearch, recorded in
+    a file so that re-indexing the tar ball only sends the documents not
+    already indexed.
+
+    Each document is recorded as a 64 bit digest of its index name and ID,
+    the file holding them sorted, as little-endian unsigned integers, after
+    a short header.  Unlike a Bloom filter, a lookup only mistakes a new
+    document for one already indexed on a collision of the digests, so no
+    document is knowingly dropped.  Including the index name means documents
+    are sent again when their index version changes.
+
+    The header also records the UUIDs of the indices the documents went to;
+    when any of them was deleted or re-created since, e.g. to re-index the
+    tar ball from scratch, the file is ignored and all documents are sent.
+    """
+
+    _header = b"pbench-indexed-ids.v2\n"
+
+    def __init__(self, path, es, logger):
+        self.path = path
+        self.es = es
+        self.logger = logger
+        self.skipped = 0
+        # The digests of the actions sent, and of those acknowledged, since
+        # the file was loaded, and the names of their indices.
+        self._sent = []
+        self._sent_indices = set()
+        self._acknowledged = []
+        self._indices = set()
+        self._known = array("Q")
+        try:
+            with open(path, "rb") as fp:
+                data = fp.read()
+        except FileNotFoundError:
+            return
+        except OSError as e:
+            logger.warning("Unable to read indexed IDs {}: {}", path, e)
+            return
+        hlen = len(self._header)
+        end = data.find(b"\n", hlen)
+        try:
+            if data[:hlen] != self._header or end < 0:
+                raise ValueError("no header")
+            uuids = json.loads(data[hlen:end].decode("utf-8"))
+            if not isinstance(uuids, dict) or (len(data) - end - 1) % 8 != 0:
+                raise ValueError("bad length")
+        except ValueError:
+            logger.warning("Ignoring corrupt indexed IDs {}", path)
+            return
+        current = self._uuids(uuids.keys())
+        if current is None:
+            return
+        if current != uuids:
+            logger.info("Ignoring indexed IDs {}, their indices were re-created", path)
+            return
+        self._indices.update(uuids.keys())
+        self._known.frombytes(data[end + 1 :])
+        if sys.byteorder == "big":
+            self._known.byteswap()
+
+    def _uuids(self, indices):
+        """Return the UUIDs of the given existing indices, by name, or None
+        if they could not be fetched.
+        """
+        if not indices:
+            return {}
+        try:
+            settings = self.es.indices.get_settings(
+                index=",".join(sorted(indices)),
+                name="index.uuid",
+                ignore_unavailable=True,
+            )
+        except Exception as exc:
+            self.logger.warning("Unable to fetch the index UUIDs: {}", exc)
+            return None
+        return {
+            name: body["settings"]["index"]["uuid"] for name, body in settings.items()
+        }
+
+    @staticmethod
+    def _digest(action):
+        key = "{}\0{}".format(action["_index"], action["_id"]).encode("utf-8")
+        return int.from_bytes(
+            hashlib.blake2b(key, digest_size=8).digest(), byteorder="little"
+        )
+
+    def __len__(self):
+        return len(self._known)
+
+    def _is_known(self, digest):
+        known = self._known
+        i = bisect.bisect_left(known, digest)
+        return i < len(known) and known[i] == digest
+
+    def filter(self, actions):
+        """Yield the given actions, dropping those of the documents already
+        indexed.
+        """
+        for action in actions:
+            digest = self._digest(action)
+            if self._is_known(digest):
+                self.skipped += 1
+                continue
+            self._sent.append(digest)
+            self._sent_indices.add(action["_index"])
+            yield action
+
+    def indexed(self, failures):
+        """The actions sent so far have been indexed, with the given number
+        of failures; unless there were none, we can't tell which documents
+        were acknowledged, so none of them are recorded.
+        """
+        if failures == 0:
+            self._acknowledged.extend(self._sent)
+            self._indices.update(self._sent_indices)
+        self._sent = []
+        self._sent_indices = set()
+
+    def save(self):
+        """Record the documents acknowledged along with those already known,
+        replacing the file atomically.
+        """
+        if not self._acknowledged:
+            return
+        uuids = self._uuids(self._indices)
+        if uuids is None or uuids.keys() != self._indices:
+            self.logger.warning(
+                "Not recording indexed IDs {}, missing index UUIDs", self.path
+            )
+            return
+        known = array("Q", sorted(set(self._known).union(self._acknowledged)))
+        if sys.byteorder == "big":
+            known.byteswap()
+        tmp_path = self.path.with_name("{}.{:d}".format(self.path.name, os.getpid()))
+        try:
+            self.path.parent.mkdir(parents=True, exist_ok=True)
+            with open(tmp_path, "wb") as fp:
+                fp.write(self._header)
+                fp.write(json.dumps(uuids, sort_keys=True).encode("utf-8") + b"\n")
+                known.tofile(fp)
+            os.replace(tmp_path, self.path)
+        except OSError as e:
+            self.logger.warning("Unable to record indexed IDs {}: {}", self.path, e)
+            try:
+                os.unlink(tmp_path)
+            except OSError:
+                pass
+
+
+# One in this many documents not already encoded is encoded to estimate the
+# bytes of the documents of its phase, or of its tool data handler.
+_BYTES_SAMPLE = 16
+
+
+# Phase of indexing which generates the documents of each index template,
+# tool data documents being accounted for by the "tool-data" phase.
+_template_phases = {
+    "run": "run",
+    "run-toc-entry": "toc",
+    "result-data": "result-data",
+    "result-data-sample": "result-data",
+}
+
+
+class IndexingStats:
+    """Wall clock time, CPU time, document count, and byte count (of the JSON
+    encoded source documents) for each phase of indexing tar balls, and for
+    the generation of the tool data documents by each tool data handler.
+    The byte counts are estimated from one in every _BYTES_SAMPLE
+    documents, unless already encoded, as noted in the statistics reported.
+
+    The phases are "open" (opening a tar ball, including "tar-listing", the
+    listing of its members), "run" (the run document), "toc" (the
+    table-of-contents documents), "result-data", "tool-data", and "bulk",
+    the time spent indexing the documents generated by the other phases.
+    When tool data documents are generated by a pool of worker processes,
+    the tool data handler times are those of the workers.
+    """
+
+    _fields = ("wall_secs", "cpu_secs", "docs", "bytes")
+
+    def __init__(self):
+        self.tarballs = 0
+        self.phases = {}
+        self.tool_data_handlers = {}
+
+    @staticmethod
+    def _entry(table, name):
+        try:
+            return table[name]
+        except KeyError:
+            entry = table[name] = [0.0, 0.0, 0, 0]
+            return entry
+
+    def add(self, phase, wall, cpu, docs=0, nbytes=0):
+        entry = self._entry(self.phases, phase)
+        entry[0] += wall
+        entry[1] += cpu
+        entry[2] += docs
+        entry[3] += nbytes
+
+    def timed_actions(self, actions):
+        """Yield the given actions, as is, accounting for the time spent
+        generating each one to the phase generating the documents of its
+        index.
+        """
+        actions = iter(actions)
+        entry = None
+        while True:
+            wall = time.perf_counter()
+            cpu = time.process_time()
+            try:
+                action = next(actions)
+            except StopIteration:
+                if entry is not None:
+                    entry[0] += time.perf_counter() - wall
+                    entry[1] += time.process_time() - cpu
+                return
+            # Index names are "<prefix>.v<version>.<template>[.<date>]".
+            template = action["_index"].split(".")[2]
+            entry = self._entry(
+                self.phases, _template_phases.get(template, "tool-data")
+            )
+            entry[0] += time.perf_counter() - wall
+            entry[1] += time.process_time() - cpu
+            source = action["_source"]
+            if isinstance(source, str):
+                entry[3] += len(source)
+            elif entry[2] % _BYTES_SAMPLE == 0:
+                entry[3] += _BYTES_SAMPLE * len(json.dumps(source, default=str))
+            entry[2] += 1
+            yield action
+
+    def timed_tool_data(self, handler, sources):
+        """Yield the given tool data (index name, source, source ID) tuples,
+        accounting for the time spent generating them to the given handler.
+        """
+        entry = self._entry(self.tool_data_handlers, handler)
+        sources = iter(sources)
+        while True:
+            wall = time.perf_counter()
+            cpu = time.process_time()
+            try:
+                item = next(sources)
+            except StopIteration:
+                entry[0] += time.perf_counter() - wall
+                entry[1] += time.process_time() - cpu
+                return
+            entry[0] += time.perf_counter() - wall
+            entry[1] += time.process_time() - cpu
+            encoded = getattr(item[2], "encoded", None)
+            if encoded is not None:
+                entry[3] += len(encoded)
+            elif entry[2] % _BYTES_SAMPLE == 0:
+                entry[3] += _BYTES_SAMPLE * len(json.dumps(item[1], default=str))
+            entry[2] += 1
+            yield item
+
+    def indexed(self, es_index_f, actions):
+        """Bulk index the given actions using es_index_f(), accounting for
+        the time spent generating them to their phases, and the rest of the
+        time to the "bulk" phase.
+
+        Returns the es_index() tuple.
+        """
+        before = self._generated()
+        wall = time.perf_counter()
+        cpu = time.process_time()
+        es_res = es_index_f(self.timed_actions(actions))
+        wall = time.perf_counter() - wall
+        cpu = time.process_time() - cpu
+        generated = [a - b for a, b in zip(self._generated(), before)]
+        self.add(
+            "bulk",
+            wall - generated[0],
+            cpu - generated[1],
+            docs=generated[2],
+            nbytes=generated[3],
+        )
+        return es_res
+
+    def _generated(self):
+        totals = [0.0, 0.0, 0, 0]
+        for phase, entry in self.phases.items():
+            if phase not in ("open", "tar-listing", "bulk"):
+                totals = [t + e for t, e in zip(totals, entry)]
+        return totals
+
+    def merge(self, other):
+        """Add the statistics of another IndexingStats object to these."""
+        self.tarballs += other.tarballs
+        for table, other_table in (
+            (self.phases, other.phases),
+            (self.tool_data_handlers, other.tool_data_handlers),
+        ):
+            for name, other_entry in other_table.items():
+                entry = self._entry(table, name)
+                entry[:] = [e + o for e, o in zip(entry, other_entry)]
+
+    def as_dict(self):
+        """Return the statistics as a dictionary suitable for a JSON document,
+        times in seconds (always floats), counts as integers, along with the
+        "bytes_sample", one in how many documents not already encoded the
+        byte counts are estimated from.
+        """
+
+        def _table(table):
+            return {
+                name: dict(
+                    zip(
+                        self._fields,
+                        (round(float(wall), 6), round(float(cpu), 6), docs, nbytes),
+                    )
+                )
+                for name, (wall, cpu, docs, nbytes) in sorted(table.items())
+            }
+
+        return dict(
+            tarballs=self.tarballs,
+            bytes_sample=_BYTES_SAMPLE,
+            phases=_table(self.phases),
+            tool_data_handlers=_table(self.tool_data_handlers),
+        )
+
+
 class PbenchData:
     """Pbench Data abstract class - ToolData and ResultData inherit from it.
 
@@ -226,6 +727,10 @@ class PbenchData:
         except KeyError:
             pass
         self.counters = Counter()
+        # Normalized timestamps by their float value in milliseconds, since
+        # the same timestamps recur across the csv files of a tool.
+        self._ts_memo = {}
+        self._abs_ts_range = None
 
     @staticmethod
     def make_source_id(source):
@@ -251,6 +756,10 @@ class PbenchData:
                 "{!r} is not a float in milliseconds since the"
                 " epoch: {}".format(orig_ts, e)
             )
+        try:
+            return self._ts_memo[orig_ts_float]
+        except KeyError:
+            pass
         ts_float = orig_ts_float / 1000
         try:
             ts = datetime.utcfromtimestamp(ts_float)
@@ -306,7 +815,51 @@ class PbenchData:
                 "{} ({!r}) is after the end of the"
                 " run ({})".format(ts, orig_ts, self.ptb.end_run_ts)
             )
-        return ts.strftime(_STD_DATETIME_FMT)
+        ts_str = _std_datetime_str(ts)
+        self._remember_ts(orig_ts_float, ts_str)
+        return ts_str
+
+    def _remember_ts(self, orig_ts_float, ts_str):
+        if len(self._ts_memo) >= _TS_MEMO_SIZE:
+            self._ts_memo.clear()
+        self._ts_memo[orig_ts_float] = ts_str
+
+    def mk_abs_timestamps_millis(self, orig_ts_list):
+        """Normalize a batch of timestamps at once, see
+        mk_abs_timestamp_millis().
+
+        Only timestamps that are plainly absolute timestamps within the run
+        are normalized, using just a comparison against the bounds of the run
+        in milliseconds since the epoch; None is returned in place of all the
+        others (relative timestamps, timestamps too close to the start or end
+        of the run to tell, or bad timestamps), for which the caller has to
+        use mk_abs_timestamp_millis() when it comes to them, so that they are
+        converted or reported, and counted, exactly as before.
+        """
+        if self._abs_ts_range is None:
+            # One millisecond of slack on each side covers any rounding in
+            # the conversion to a datetime.
+            self._abs_ts_range = (
+                (self.ptb.start_run_ts - _EPOCH).total_seconds() * 1000 + 1,
+                (self.ptb.end_run_ts - _EPOCH).total_seconds() * 1000 - 1,
+            )
+        lo, hi = self._abs_ts_range
+        memo = self._ts_memo
+        ts_strs = []
+        for orig_ts in orig_ts_list:
+            try:
+                orig_ts_float = float(orig_ts)
+            except (TypeError, ValueError):
+                ts_strs.append(None)
+                continue
+            ts_str = memo.get(orig_ts_float)
+            if ts_str is None and lo < orig_ts_float < hi:
+                ts_str = _std_datetime_str(
+                    datetime.utcfromtimestamp(orig_ts_float / 1000)
+                )
+                self._remember_ts(orig_ts_float, ts_str)
+            ts_strs.append(ts_str)
+        return ts_strs
 
     def generate_index_name(self, template_name, source, toolname=None):
         """Return a fully formed index name given its template, prefix, source
@@ -323,6 +876,114 @@ class PbenchData:
         )
 
 
+class _NotJsonArray(Exception):
+    """The JSON document streamed by _json_array_items() is valid, but not an
+    array.
+    """
+
+    pass
+
+
+# JSON white space, as skipped by the json module's own decoder.
+_json_ws = re.compile(r"[ \t\n\r]*")
+
+
+class _JsonStream:
+    """A JSON document read a block at a time, keeping only the text not yet
+    decoded.
+    """
+
+    def __init__(self, file_object, block_size):
+        self.file_object = file_object
+        self.block_size = block_size
+        self.decode = json.JSONDecoder().raw_decode
+        self.buf = ""
+        self.pos = 0
+        self.eof = False
+
+    def read(self):
+        """Read another block, returning False at the end of the file.
+
+        Blocks at least as large as the text still held are read so that a
+        value spanning many blocks is only decoded a few times over.
+        """
+        if self.eof:
+            return False
+        block = self.file_object.read(
+            max(self.block_size, len(self.buf) - self.pos)
+        )
+        if not block:
+            self.eof = True
+            return False
+        self.buf = self.buf[self.pos :] + block
+        self.pos = 0
+        return True
+
+    def peek(self):
+        """Skip any white space, returning the next character, or "" at the
+        end of the file.
+        """
+        while True:
+            self.pos = _json_ws.match(self.buf, self.pos).end()
+            if self.pos < len(self.buf):
+                return self.buf[self.pos]
+            if not self.read():
+                return ""
+
+    def value(self):
+        """Decode the next value."""
+        while True:
+            try:
+                val, end = self.decode(self.buf, self.pos)
+            except json.JSONDecodeError:
+                # The value might just not have been read in full yet.
+                if self.read():
+                    continue
+                raise
+            if len(self.buf) - end <= 2 and self.read():
+                # A number ending the text read so far might continue, e.g.
+                # "1.5" or "1e-3" read as far as "1." or "1e-".
+                continue
+            self.pos = end
+            return val
+
+    def fail(self, msg):
+        raise json.JSONDecodeError(msg, self.buf, self.pos)
+
+
+def _json_array_items(file_object, block_size=_JSON_BLOCK_SIZE):
+    """Yield each element of the JSON array held by the given file, decoding
+    one element at a time, so that only one is ever held in memory.
+
+    The elements are decoded exactly as json.load() would decode them.  An
+    invalid document raises ValueError, possibly only after some elements
+    were yielded; a valid document that is not an array raises _NotJsonArray.
+    """
+    stream = _JsonStream(file_object, block_size)
+    if stream.peek() != "[":
+        # Let the json module sort out whether this is valid JSON at all.
+        while stream.read():
+            pass
+        json.loads(stream.buf[stream.pos :])
+        raise _NotJsonArray()
+    stream.pos += 1
+    if stream.peek() == "]":
+        stream.pos += 1
+    else:
+        while True:
+            stream.peek()
+            yield stream.value()
+            c = stream.peek()
+            stream.pos += 1
+            if c == "]":
+                break
+            if c != ",":
+                stream.pos -= 1
+                stream.fail("Expecting ',' delimiter")
+    if stream.peek() != "":
+        stream.fail("Extra data")
+
+
 ###########################################################################
 #
 
@@ -906,31 +1567,22 @@ class ResultData(PbenchData):
                 continue
 
             result_json = os.path.join(self.ptb.extracted_root, dirname, "result.json")
-            try:
-                # Read the file and interpret it as a JSON document.
-                with open(result_json) as fp:
-                    results = json.load(fp)
-            except Exception as e:
-                self.logger.warning(
-                    "result-data-indexing: encountered invalid JSON file,"
-                    " {}: {:r} ({})",
-                    result_json,
-                    e,
-                    self.ptb._tbctx,
-                )
-                self.counters["not_valid_json_file"] += 1
-                continue
+            if self.idxctx.streaming_results:
+                results = self._stream_result_json(result_json)
+            else:
+                try:
+                    # Read the file and interpret it as a JSON document.
+                    with open(result_json) as fp:
+                        results = json.load(fp)
+                except Exception as e:
+                    self._invalid_result_json(result_json, e)
+                    continue
 
-            # The outer results object should be an array of iterations. Probe
-            # to see if that is true.
-            if not isinstance(results, list):
-                self.logger.warning(
-                    "result-data-indexing: encountered unexpected"
-                    " JSON file format, %s ({})",
-                    result_json,
-                    self.ptb._tbctx,
-                )
-                continue
+                # The outer results object should be an array of iterations.
+                # Probe to see if that is true.
+                if not isinstance(results, list):
+                    self._unexpected_result_json(result_json)
+                    continue
 
             for iteration in results:
                 try:
@@ -1005,6 +1657,45 @@ class ResultData(PbenchData):
                     yield src, _id, _parent, _type
         return
 
+    def _stream_result_json(self, result_json):
+        """Generate the iterations of the given result.json file, reading it
+        one iteration at a time.
+
+        The file is first read through once without keeping any iteration,
+        so that an invalid file is reported as it would be when read as a
+        whole, without any of its iterations being generated.
+        """
+        try:
+            with open(result_json) as fp:
+                for _ in _json_array_items(fp):
+                    pass
+        except _NotJsonArray:
+            self._unexpected_result_json(result_json)
+            return
+        except Exception as e:
+            self._invalid_result_json(result_json, e)
+            return
+        with open(result_json) as fp:
+            yield from _json_array_items(fp)
+
+    def _invalid_result_json(self, result_json, e):
+        self.logger.warning(
+            "result-data-indexing: encountered invalid JSON file,"
+            " {}: {:r} ({})",
+            result_json,
+            e,
+            self.ptb._tbctx,
+        )
+        self.counters["not_valid_json_file"] += 1
+
+    def _unexpected_result_json(self, result_json):
+        self.logger.warning(
+            "result-data-indexing: encountered unexpected"
+            " JSON file format, %s ({})",
+            result_json,
+            self.ptb._tbctx,
+        )
+
     def _handle_iteration(self, iter_data, iter_name, iter_number, result_json):
         """Generate source documents for iteration data.
         """
@@ -1797,14 +2488,433 @@ _aliases = {
 }
 
 
+class _RowAtATime(Exception):
+    pass
+
+
+def _convert_column(converter, values):
+    """Convert a column of values read from a .csv file using the given
+    converter, returning a sequence of the converted values; float and int
+    values are stored in compact arrays.
+    """
+    if converter is float:
+        return array("d", map(float, values))
+    elif converter is int:
+        try:
+            return array("q", map(int, values))
+        except OverflowError:
+            return list(map(int, values))
+    elif converter is _noop:
+        return values
+    return list(map(converter, values))
+
+
 def _noop(arg):
     return arg
 
 
+def _stdout_records(file_object, block_size=_STDOUT_BLOCK_SIZE):
+    """Read a "periodic_timestamp" stdout file a large block at a time,
+    splitting it into records at its "timestamp:" lines.
+
+    Yields the text preceding the first "timestamp:" line as (None, text),
+    and then each record as (header, body), where the header is the rest of
+    its "timestamp:" line, and the body holds all of the lines following it
+    up to the next "timestamp:" line, each ending with a newline (except for
+    the last line of a file not ending with one).
+    """
+    carry = ""
+    first = True
+    while True:
+        block = file_object.read(block_size)
+        data = carry + block
+        if block:
+            # Only the records followed by a "timestamp:" line are known to
+            # be complete, the rest is carried over to the next block.
+            end = data.rfind("\ntimestamp:")
+            if end < 0:
+                carry = data
+                continue
+            carry = data[end + 1 :]
+            data = data[: end + 1]
+        elif not data:
+            return
+        parts = ("\n" + data).split("\ntimestamp:")
+        last = len(parts) - 1
+        for i, part in enumerate(parts):
+            if i < last:
+                # Restore the newline preceding the next "timestamp:" line.
+                part += "\n"
+            if i > 0:
+                header, _, body = part.partition("\n")
+                yield header, body
+            elif first:
+                first = False
+                if len(part) > 1:
+                    yield None, part[1:]
+        if not block:
+            return
+
+
+def _stdout_lines(body):
+    """Return the lines of the body of a stdout file record, without their
+    newlines.
+    """
+    lines = body.split("\n")
+    if lines[-1] == "":
+        lines.pop()
+    return lines
+
+
+# Record bodies of "keyval" stdout files which hold nothing but "<key> <value>"
+# lines.
+_keyval_body = re.compile(r"(?:\S+ \S+\n)*(?:\S+ \S+)?")
+
+
+class _KeyvalLayout:
+    """How the keys of the records of a "keyval" stdout file map to the fields
+    of their gauge and rate dictionaries, worked out once for each distinct
+    list of keys.
+
+    Keys of the form "<stat>_<substat>" are grouped under their stat, while
+    others are (possibly remapped) stats of their own.  A layout is "exact"
+    unless some key is repeated, or some stat is both a stat of its own and
+    a group of sub-stats, in which case the fields depend on the order of
+    the keys, and records are processed a line at a time instead.
+    """
+
+    def __init__(self, keys, remaps):
+        self.keys = keys
+        # (stat, None, position) for stats of their own, and (stat, substats,
+        # slice or positions) for groups of sub-stats, in the order the stats
+        # first appear.
+        self.plan = []
+        self.exact = True
+        groups = {}
+        simple = set()
+        pairs = set()
+        for pos, key in enumerate(keys):
+            parts = key.split("_", 1)
+            if len(parts) == 1:
+                stat = key
+                if remaps is not None:
+                    try:
+                        stat = remaps["key"][key]
+                    except KeyError:
+                        pass
+                if stat in simple or stat in groups:
+                    self.exact = False
+                simple.add(stat)
+                self.plan.append((stat, None, pos))
+            else:
+                stat, substat = parts
+                if stat in simple or (stat, substat) in pairs:
+                    self.exact = False
+                pairs.add((stat, substat))
+                try:
+                    substats, positions = groups[stat]
+                except KeyError:
+                    substats, positions = groups[stat] = ([], [])
+                    self.plan.append((stat, substats, positions))
+                substats.append(substat)
+                positions.append(pos)
+        for i, (stat, substats, where) in enumerate(self.plan):
+            if substats is not None and where == list(
+                range(where[0], where[-1] + 1)
+            ):
+                self.plan[i] = (stat, substats, slice(where[0], where[-1] + 1))
+
+    @staticmethod
+    def _select(values, where):
+        if isinstance(where, slice):
+            return values[where]
+        return [values[pos] for pos in where]
+
+    def gauge(self, values):
+        """Return the gauge dictionary of the given converted values."""
+        gauge = _dict_const()
+        for stat, substats, where in self.plan:
+            if substats is None:
+                gauge[stat] = values[where]
+            else:
+                gauge[stat] = _dict_const(zip(substats, self._select(values, where)))
+        return gauge
+
+    def values(self, gauge):
+        """Return the values of the given gauge dictionary, of a record with
+        the same keys, in the order of the keys.
+        """
+        values = [None] * len(self.keys)
+        for stat, substats, where in self.plan:
+            if substats is None:
+                values[where] = gauge[stat]
+            else:
+                sub_gauge = gauge[stat]
+                if isinstance(where, slice):
+                    where = range(where.start, where.stop)
+                for substat, pos in zip(substats, where):
+                    values[pos] = sub_gauge[substat]
+        return values
+
+    def rate(self, diffs, duration, sub_duration):
+        """Return the rate dictionary of the given value differences, where
+        the rates of the sub-stats are over their own duration.
+        """
+        rate = _dict_const()
+        for stat, substats, where in self.plan:
+            if substats is None:
+                rate[stat] = diffs[where] / duration
+            else:
+                rate[stat] = _dict_const(
+                    zip(
+                        substats,
+                        [diff / sub_duration for diff in self._select(diffs, where)],
+                    )
+                )
+        return rate
+
+
+class SourceEncoder:
+    """Compact JSON encoder for the tool data source documents of a ToolData
+    object.
+
+    Every document embeds the same run, iteration, and sample metadata
+    dictionaries, so they are encoded once, and their encodings spliced into
+    the encoding of each document; only the fields varying with each document
+    are encoded per document.  The result is the same as encoding the whole
+    document with separators=(",", ":").
+    """
+
+    def __init__(self, td):
+        self._td = td
+        self._encode = json.JSONEncoder(separators=(",", ":")).encode
+        self._fragments = None
+
+    def encode(self, source):
+        fragments = self._fragments
+        if fragments is None:
+            # Deferred until the first document, after the ToolData object
+            # has finished constructing its metadata.
+            td = self._td
+            fragments = self._fragments = {
+                id(md): self._encode(md)
+                for md in (td.run_metadata, td.iteration_metadata, td.sample_metadata)
+            }
+        encode = self._encode
+        return "{%s}" % ",".join(
+            [
+                "%s:%s" % (encode(key), fragments.get(id(val)) or encode(val))
+                for key, val in source.items()
+            ]
+        )
+
+
+class LegacySourceIds:
+    """Tool data document ID strategy generating the original document IDs:
+    the MD5 of the JSON encoding of the source document with sorted keys.
+
+    When the "preencoded_bodies" indexing option is enabled, the documents
+    are also encoded using a SourceEncoder for use as the bulk request bodies.
+    """
+
+    def __init__(self, td):
+        if td.idxctx.preencoded_bodies:
+            self._encode = SourceEncoder(td).encode
+        else:
+            self._encode = None
+
+    def source_id(self, source):
+        source_id = PbenchData.make_source_id(source)
+        if self._encode is None:
+            return source_id
+        return _mk_source_id(source_id, self._encode(source))
+
+
+class SourceId(str):
+    """A document ID which also carries the JSON encoding of the source
+    document from which it was computed, so that the encoding can be re-used
+    as the body of the document.
+    """
+
+    __slots__ = ("encoded",)
+
+    def __reduce__(self):
+        return (_mk_source_id, (str(self), self.encoded))
+
+
+def _mk_source_id(source_id, encoded):
+    sid = SourceId(source_id)
+    sid.encoded = encoded
+    return sid
+
+
+class FastSourceIds:
+    """Tool data document ID strategy hashing a single compact, unsorted JSON
+    encoding of the source document, which is also used as the body of the
+    document in the bulk request.
+
+    The encoding follows the order in which the fields are added to the
+    source document by each tool data handler, which is fixed, so the IDs are
+    stable across indexing passes of the same tar ball by the same version of
+    the indexer.  The IDs differ from the original ones, so a tar ball must be
+    re-indexed with the same strategy it was first indexed with to avoid
+    creating duplicate documents.
+
+    As with the original IDs, the whole document is hashed, not just the
+    fields identifying it: the tool data handlers don't declare which fields
+    those are, and the documents which get the same ID are then exactly those
+    which did before.  The encoding has to be produced for the body anyway,
+    so hashing it only adds the MD5 of bytes already at hand.
+    """
+
+    def __init__(self, td):
+        self._encode = SourceEncoder(td).encode
+
+    def source_id(self, source):
+        encoded = self._encode(source)
+        return _mk_source_id(hashlib.md5(encoded.encode("utf-8")).hexdigest(), encoded)
+
+
+# Tool data document ID strategies, selected via the "document_ids" option of
+# the [Indexing] section of the configuration.
+_source_id_strategies = {"legacy": LegacySourceIds, "fast": FastSourceIds}
+
+
+def _rollup_fields(obj, prefix, ids, metrics):
+    """Collect the string fields (identifiers) and numeric fields (metrics)
+    of the given tool data (sub-)document, by their dotted path names.
+    """
+    for key, val in obj.items():
+        if key == "@idx":
+            continue
+        name = prefix + key
+        if isinstance(val, dict):
+            _rollup_fields(val, name + ".", ids, metrics)
+        elif isinstance(val, str):
+            ids.append((name, val))
+        elif isinstance(val, (int, float)) and not isinstance(val, bool):
+            metrics.append((name, val))
+
+
+class ToolDataRollup:
+    """Downsampled rollups of the documents of one unit of tool data (one tool
+    on one host for one sample of an iteration): the count, minimum, maximum,
+    average, and 95th percentile of each metric of each identifier (e.g. a
+    disk, CPU, or process), for each minute and for the whole sample.
+
+    The identifier of a tool data document is its "id" field, or, without
+    one, all of its string fields; all of its other numeric fields are
+    metrics.
+    """
+
+    def __init__(self, td):
+        self.td = td
+        # Values of each (identifier, metric) by minute ("YYYY-mm-ddTHH:MM"),
+        # along with the first and last timestamps seen for each.
+        self.values = defaultdict(lambda: defaultdict(lambda: array("d")))
+        self.bounds = {}
+
+    def add(self, source):
+        ts = source["@timestamp"]
+        ids = []
+        metrics = []
+        _rollup_fields(source[self.td.toolname], "", ids, metrics)
+        ids = dict(ids)
+        try:
+            ident = ids["id"]
+        except KeyError:
+            ident = ",".join("{}={}".format(k, v) for k, v in sorted(ids.items()))
+        minute = ts[:16]
+        for metric, val in metrics:
+            key = (ident, metric)
+            self.values[key][minute].append(val)
+            try:
+                first, last = self.bounds[key]
+            except KeyError:
+                self.bounds[key] = (ts, ts)
+            else:
+                if ts < first:
+                    self.bounds[key] = (ts, last)
+                elif ts > last:
+                    self.bounds[key] = (first, ts)
+
+    def _mk_source(self, ident, metric, window, start, end, values):
+        values = sorted(values)
+        count = len(values)
+        rollup = _dict_const(
+            [
+                ("window", window),
+                ("start", start),
+                ("end", end),
+                ("count", count),
+                ("min", values[0]),
+                ("max", values[-1]),
+                ("avg", math.fsum(values) / count),
+                ("p95", values[max(0, math.ceil(0.95 * count) - 1)]),
+            ]
+        )
+        td = self.td
+        return _dict_const(
+            [
+                ("@timestamp", start),
+                ("run", td.run_metadata),
+                ("iteration", td.iteration_metadata),
+                ("sample", td.sample_metadata),
+                ("tool", _dict_const(name=td.toolname, id=ident, metric=metric)),
+                ("rollup", rollup),
+            ]
+        )
+
+    def sources(self):
+        """Yield the (index name, source, source ID) tuples of the rollup
+        documents, the rollup of the whole sample of each metric of each
+        identifier followed by those of each minute.
+        """
+        td = self.td
+        for key in sorted(self.values):
+            ident, metric = key
+            by_minute = self.values[key]
+            first, last = self.bounds[key]
+            sources = [
+                self._mk_source(
+                    ident,
+                    metric,
+                    "sample",
+                    first,
+                    last,
+                    [val for minute in by_minute.values() for val in minute],
+                )
+            ]
+            for minute in sorted(by_minute):
+                start = datetime.strptime(minute, "%Y-%m-%dT%H:%M")
+                sources.append(
+                    self._mk_source(
+                        ident,
+                        metric,
+                        "1m",
+                        _std_datetime_str(start),
+                        _std_datetime_str(start + timedelta(minutes=1)),
+                        by_minute[minute],
+                    )
+                )
+            for source in sources:
+                try:
+                    idx_name = td.generate_index_name(
+                        "tool-data-rollup", source, toolname=td.toolname
+                    )
+                except BadDate:
+                    pass
+                else:
+                    yield idx_name, source, td.make_source_id(source)
+
+
 class ToolData(PbenchData):
     def __init__(self, ptb, iteration, sample, host, tool):
         super().__init__(ptb)
         self.toolname = tool
+        self.make_tool_source_id = _source_id_strategies[
+            self.idxctx.document_ids
+        ](self).source_id
         self.idxctx.opctx.append(
             _dict_const(
                 tbname=ptb.tbname,
@@ -2054,45 +3164,16 @@ class ToolData(PbenchData):
         # At this point, we have processed all the data about csv files
         # and are ready to start reading the contents of all the csv
         # files and building the unified records.
-        def rows_generator():
-            # We use this generator to highlight the process of reading from
-            # all the csv files, reading one row from each of the csv files,
-            # returning that as a dictionary of csv file to row read, which
-            # in turn is yielded by the generator.
-            idx = 0
-            while True:
-                # Read a row from each .csv file
-                rows = _dict_const()
-                for csvf in self.files:
-                    try:
-                        rows[csvf["basename"]] = next(csvf["reader"])
-                    except StopIteration:
-                        # This should handle the case of mismatched number of
-                        # rows across all .csv files. All readers which have
-                        # finished will emit a StopIteration.
-                        pass
-                if not rows:
-                    # None of the csv file readers returned any rows to
-                    # process, so we're done.
-                    break
-                # Yield the one dictionary that contains each newly read row
-                # from all the csv files.
-                yield idx, rows
-                idx += 1
-
-        self.logger.info(
-            "tool-data-indexing: tool {}, gen unified begin for {}",
-            self.toolname,
-            self.basepath,
-        )
         prev_first = None
         prev_ts_val = None
-        for idx, rows in rows_generator():
-            # Verify timestamps are all the same for this row.
-            tstamp = None
+
+        def row_timestamp(timestamps, ts_val=None):
+            # Verify the given timestamps for a row from each csv file are
+            # all the same, returning the first one along with its
+            # normalized value (unless already normalized by the caller).
+            nonlocal prev_first, prev_ts_val
             first = None
-            for fname in rows.keys():
-                tstamp = rows[fname][0]
+            for tstamp in timestamps:
                 if first is None:
                     first = tstamp
                 elif first != tstamp:
@@ -2104,6 +3185,21 @@ class ToolData(PbenchData):
                     )
                     self.counters["inconsistent_timestamps_across_csv_files"] += 1
                     break
+            # The timestamp is taken from the "first" timestamp, converted
+            # to a floating point value in seconds, and then formatted as a
+            # string.
+            if ts_val is None:
+                ts_val = self.mk_abs_timestamp_millis(first)
+            if prev_ts_val is not None:
+                assert prev_ts_val <= ts_val, (
+                    "prev_ts_val (%r, %r) > first (%r, %r)"
+                    % (prev_ts_val, prev_first, ts_val, first)
+                )
+            prev_first = first
+            prev_ts_val = ts_val
+            return first, ts_val
+
+        def new_datum(idx, first, ts_val):
             # We are now ready to create a base document per identifier to
             # hold all the fields from the various columns. Given the two
             # input dictionaries, "identifiers" and "metadata", we create
@@ -2129,18 +3225,6 @@ class ToolData(PbenchData):
             #                        self.toolname: { "id": "id1",
             #                                         "f1": "faz",
             #                                         "f2": "baz" } },
-
-            # The timestamp is taken from the "first" timestamp, converted
-            # to a floating point value in seconds, and then formatted as a
-            # string.
-            ts_val = self.mk_abs_timestamp_millis(first)
-            if prev_ts_val is not None:
-                assert prev_ts_val <= ts_val, (
-                    "prev_ts_val (%r, %r) > first (%r, %r)"
-                    % (prev_ts_val, prev_first, ts_val, first)
-                )
-            prev_first = first
-            prev_ts_val = ts_val
             datum = _dict_const()
             for identifier in identifiers.keys():
                 datum[identifier] = _dict_const(
@@ -2166,6 +3250,14 @@ class ToolData(PbenchData):
                     datum[identifier][self.toolname].update(md)
                 for klass in class_list.keys():
                     datum[identifier][self.toolname][klass] = _dict_const()
+            return datum
+
+        def row_sources(idx, rows):
+            # Generate the records for the given dictionary of csv file to
+            # row read, one row from each csv file, converting each value
+            # as it is mapped to its field.
+            first, ts_val = row_timestamp(rows[fname][0] for fname in rows.keys())
+            datum = new_datum(idx, first, ts_val)
             # Now we can perform the mapping from multiple .csv files to JSON
             # documents using a known field hierarchy (no identifiers in field
             # names) with the identifiers as additional metadata. Note that we
@@ -2193,8 +3285,104 @@ class ToolData(PbenchData):
             # to their proper fields for each identifier. Now we can yield
             # records for each of the identifiers.
             for _id, source in datum.items():
-                source_id = PbenchData.make_source_id(source)
+                source_id = self.make_tool_source_id(source)
                 yield source, source_id
+
+        headers = {csvf["basename"]: csvf["header"] for csvf in self.files}
+
+        def block_sources(idx0, blocks):
+            # Generate the records for the given block of rows read from
+            # each csv file, converting the values a column at a time, and
+            # only building the records from the converted columns as they
+            # are emitted.
+            nrows = max(len(block) for block in blocks.values())
+            columns = _dict_const()
+            try:
+                for fname, block in blocks.items():
+                    width = len(headers[fname])
+                    if fname not in metric_mapping or any(
+                        len(row) != width for row in block
+                    ):
+                        # Ragged rows, or a csv file we can't map.
+                        raise _RowAtATime()
+                    klass, metric, converter = metric_mapping[fname]
+                    cols = list(zip(*block))
+                    columns[fname] = (
+                        cols[0],
+                        [None] + [_convert_column(converter, col) for col in cols[1:]],
+                    )
+            except Exception:
+                # Any block the columns of which can't be converted is
+                # processed a row at a time, so that the records and errors
+                # are the same as they would be otherwise.
+                for i in range(nrows):
+                    rows = _dict_const()
+                    for fname, block in blocks.items():
+                        if i < len(block):
+                            rows[fname] = block[i]
+                    yield from row_sources(idx0 + i, rows)
+                return
+            # The plan for mapping each column of a csv file to the field of
+            # the record for its identifier.
+            plans = _dict_const()
+            for fname in columns.keys():
+                klass, metric, converter = metric_mapping[fname]
+                plans[fname] = [
+                    (col, field_mapping[fname][col], klass, metric)
+                    for col in range(1, len(headers[fname]))
+                ]
+            presents = [
+                [fname for fname in columns.keys() if i < len(blocks[fname])]
+                for i in range(nrows)
+            ]
+            # Normalize the timestamps of the block in one go; any that are
+            # not normalized here are left to row_timestamp().
+            ts_vals = self.mk_abs_timestamps_millis(
+                columns[present[0]][0][i] for i, present in enumerate(presents)
+            )
+            for i, present in enumerate(presents):
+                first, ts_val = row_timestamp(
+                    (columns[fname][0][i] for fname in present), ts_vals[i]
+                )
+                datum = new_datum(idx0 + i, first, ts_val)
+                for fname in present:
+                    vals = columns[fname][1]
+                    for col, (identifier, subfield), klass, metric in plans[fname]:
+                        if klass is not None:
+                            _d = datum[identifier][self.toolname][klass]
+                        else:
+                            _d = datum[identifier][self.toolname]
+                        if subfield:
+                            if metric not in _d:
+                                _d[metric] = _dict_const()
+                            _d[metric][subfield] = vals[col][i]
+                        else:
+                            _d[metric] = vals[col][i]
+                for _id, source in datum.items():
+                    source_id = self.make_tool_source_id(source)
+                    yield source, source_id
+
+        self.logger.info(
+            "tool-data-indexing: tool {}, gen unified begin for {}",
+            self.toolname,
+            self.basepath,
+        )
+        # Read the rows from all the csv files in lock step, a block at a
+        # time, to process the block a column at a time.  Any csv files with
+        # fewer rows than the rest are simply left out once they run out.
+        idx = 0
+        while True:
+            blocks = _dict_const()
+            for csvf in self.files:
+                block = list(islice(csvf["reader"], _CSV_BLOCK_ROWS))
+                if block:
+                    blocks[csvf["basename"]] = block
+            if not blocks:
+                # None of the csv file readers returned any rows to
+                # process, so we're done.
+                break
+            yield from block_sources(idx, blocks)
+            idx += max(len(block) for block in blocks.values())
         self.logger.info(
             "tool-data-indexing: tool {}, end unified for {}",
             self.toolname,
@@ -2269,7 +3457,7 @@ class ToolData(PbenchData):
                         column = header[col]
                         _d[metric][column] = converter(val)
 
-                source_id = PbenchData.make_source_id(datum)
+                source_id = self.make_tool_source_id(datum)
                 yield datum, source_id
                 idx += 1
             self.logger.info(
@@ -2341,7 +3529,15 @@ class ToolData(PbenchData):
         keyN: 100.N
         timestamp: ...
 
+        The file is read a large block at a time and split into records at
+        its "timestamp:" lines.  The key/value pairs of a record are converted
+        in one go, and the gauge and rate dictionaries built following the
+        layout of its keys (see _KeyvalLayout), which is usually the same for
+        all the records of a file.  Records whose layout is not exact, or
+        whose lines are not all "<key> <value>", are processed a line at a
+        time (see _keyval_lines()).
         """
+        toolname = self.toolname
         record = None
         prev_gauge = None
         ts_orig = None
@@ -2349,95 +3545,145 @@ class ToolData(PbenchData):
         try:
             # Fetch the remaps table to see if any naming conflicts need to be
             # resolved.
-            remaps = self._remaps[self.toolname]
+            remaps = self._remaps[toolname]
         except KeyError:
             remaps = None
+        layout = None
+        # The layout and converted values of the previous record, when it
+        # was processed using a layout.
+        prev_layout = None
+        prev_values = None
         idx = 0
         self.logger.info(
-            "tool-data-indexing: tool {}, stdout keyval start {}", self.toolname, path
+            "tool-data-indexing: tool {}, stdout keyval start {}", toolname, path
         )
-        for line in file_object:
-            if line.startswith("timestamp:"):
-                prev_ts_orig = ts_orig
-                if record:
-                    # timestamp delimits records, yield last record.
-                    if not record[self.toolname]["rate"]:
-                        # For first record, rate will be empty, so
-                        # don't emit it.
-                        del record[self.toolname]["rate"]
-                    yield record
-                    idx += 1
-                    # Be sure to remember the record we just emitted
-                    # so that it is available for rate calculations.
-                    prev_gauge = record[self.toolname]["gauge"]
-                # Get the second column, the timestamp value, which is
-                # *seconds* since the epoch, and then convert to millis
-                # since the epoch.
-                ts_orig = float(line.split(":")[1])
-                if prev_ts_orig is not None:
-                    assert prev_ts_orig <= ts_orig, "prev_ts_orig %r > ts_orig %r" % (
-                        prev_ts_orig,
-                        ts_orig,
-                    )
-                ts_str = self.mk_abs_timestamp_millis(ts_orig * 1000)
-                record = _dict_const()
-                record["@timestamp"] = ts_str
-                record["@timestamp_original"] = str(ts_orig)
-                record["run"] = self.run_metadata
-                record["iteration"] = self.iteration_metadata
-                record["sample"] = self.sample_metadata
-                record[self.toolname] = _dict_const()
-                record[self.toolname]["@idx"] = idx
-                record[self.toolname]["gauge"] = gauge = _dict_const()
-                record[self.toolname]["rate"] = rate = _dict_const()
-            elif ts_orig is None:
-                # We have not encountered a timestamp yet, so ignore
-                # all lines until the first timestamp.
+        for header, body in _stdout_records(file_object):
+            if header is None:
+                # Ignore all lines until the first timestamp.
                 continue
+            prev_ts_orig = ts_orig
+            if record:
+                # timestamp delimits records, yield last record.
+                if not record[toolname]["rate"]:
+                    # For first record, rate will be empty, so
+                    # don't emit it.
+                    del record[toolname]["rate"]
+                yield record
+                idx += 1
+                # Be sure to remember the record we just emitted
+                # so that it is available for rate calculations.
+                prev_gauge = record[toolname]["gauge"]
+            # The timestamp value is *seconds* since the epoch, which we
+            # convert to millis since the epoch.
+            ts_orig = float(header.split(":", 1)[0])
+            if prev_ts_orig is not None:
+                assert prev_ts_orig <= ts_orig, "prev_ts_orig %r > ts_orig %r" % (
+                    prev_ts_orig,
+                    ts_orig,
+                )
+            ts_str = self.mk_abs_timestamp_millis(ts_orig * 1000)
+            record = _dict_const()
+            record["@timestamp"] = ts_str
+            record["@timestamp_original"] = str(ts_orig)
+            record["run"] = self.run_metadata
+            record["iteration"] = self.iteration_metadata
+            record["sample"] = self.sample_metadata
+            record[toolname] = _dict_const()
+            record[toolname]["@idx"] = idx
+            if _keyval_body.fullmatch(body):
+                tokens = body.split()
+                keys = tokens[0::2]
+                if layout is None or keys != layout.keys:
+                    layout = _KeyvalLayout(keys, remaps)
             else:
-                key, value = line.strip().split(" ")
-                parts = key.split("_", 1)
-                if len(parts) == 1:
-                    # For keys that are not split into stat and substat, look
-                    # to see if the stat needs to be rename to avoid conflict
-                    # with other keys that might share the same prefix.
-                    if remaps is not None:
-                        try:
-                            stat = remaps["key"][key]
-                        except KeyError:
-                            stat = key
-                    else:
-                        stat = key
-                    gauge[stat] = converter(value)
-                    if prev_ts_orig:
-                        # Note we don't record the rate on the first value
-                        # encountered.
-                        duration = ts_orig - prev_ts_orig
-                        value_diff = int(value) - prev_gauge[stat]
-                        the_rate = value_diff / duration
-                        rate[stat] = the_rate
-                else:
-                    assert len(parts) == 2, "Logic bomb! parts is not parts!"
-                    stat = parts[0]
-                    substat = parts[1]
-                    if stat not in gauge:
-                        gauge[stat] = _dict_const()
-                    gauge[stat][substat] = converter(value)
-                    if prev_ts_orig:
-                        # Note we don't record the rate on the first value
-                        # encountered.
-                        duration = (ts_orig / 1000) - (prev_ts_orig / 1000)
-                        value_diff = int(value) - prev_gauge[stat][substat]
-                        the_rate = value_diff / duration
-                        if stat not in rate:
-                            rate[stat] = _dict_const()
-                        rate[stat][substat] = the_rate
-        if record and record[self.toolname]["gauge"]:
+                layout = None
+            if layout is None or not layout.exact:
+                record[toolname]["gauge"] = gauge = _dict_const()
+                record[toolname]["rate"] = rate = _dict_const()
+                self._keyval_lines(
+                    _stdout_lines(body),
+                    converter,
+                    remaps,
+                    gauge,
+                    rate,
+                    ts_orig,
+                    prev_ts_orig,
+                    prev_gauge,
+                )
+                prev_layout = None
+                continue
+            values = tokens[1::2]
+            converted = list(map(converter, values))
+            record[toolname]["gauge"] = layout.gauge(converted)
+            if prev_ts_orig:
+                # Note we don't record the rate on the first value
+                # encountered.
+                if prev_layout is not layout:
+                    prev_values = layout.values(prev_gauge)
+                ints = converted if converter is int else list(map(int, values))
+                diffs = [val - prev for val, prev in zip(ints, prev_values)]
+                record[toolname]["rate"] = layout.rate(
+                    diffs,
+                    ts_orig - prev_ts_orig,
+                    (ts_orig / 1000) - (prev_ts_orig / 1000),
+                )
+            else:
+                record[toolname]["rate"] = _dict_const()
+            prev_layout = layout
+            prev_values = converted
+        if record and record[toolname]["gauge"]:
             yield record
         self.logger.info(
-            "tool-data-indexing: tool {}, stdout keyval end {}", self.toolname, path
+            "tool-data-indexing: tool {}, stdout keyval end {}", toolname, path
         )
 
+    @staticmethod
+    def _keyval_lines(
+        lines, converter, remaps, gauge, rate, ts_orig, prev_ts_orig, prev_gauge
+    ):
+        """Add the key/value pairs of the given lines of a record of a stdout
+        key/value pair output file to its gauge and rate dictionaries, a line
+        at a time.
+        """
+        for line in lines:
+            key, value = line.strip().split(" ")
+            parts = key.split("_", 1)
+            if len(parts) == 1:
+                # For keys that are not split into stat and substat, look
+                # to see if the stat needs to be rename to avoid conflict
+                # with other keys that might share the same prefix.
+                if remaps is not None:
+                    try:
+                        stat = remaps["key"][key]
+                    except KeyError:
+                        stat = key
+                else:
+                    stat = key
+                gauge[stat] = converter(value)
+                if prev_ts_orig:
+                    # Note we don't record the rate on the first value
+                    # encountered.
+                    duration = ts_orig - prev_ts_orig
+                    value_diff = int(value) - prev_gauge[stat]
+                    the_rate = value_diff / duration
+                    rate[stat] = the_rate
+            else:
+                assert len(parts) == 2, "Logic bomb! parts is not parts!"
+                stat = parts[0]
+                substat = parts[1]
+                if stat not in gauge:
+                    gauge[stat] = _dict_const()
+                gauge[stat][substat] = converter(value)
+                if prev_ts_orig:
+                    # Note we don't record the rate on the first value
+                    # encountered.
+                    duration = (ts_orig / 1000) - (prev_ts_orig / 1000)
+                    value_diff = int(value) - prev_gauge[stat][substat]
+                    the_rate = value_diff / duration
+                    if stat not in rate:
+                        rate[stat] = _dict_const()
+                    rate[stat][substat] = the_rate
+
     def _stdout_procint(self, file_object, converter, path):
         """Process the two-dimensional proc-interrupts output.
 
@@ -2449,7 +3695,12 @@ class ToolData(PbenchData):
         NMI:          0          0          0          0   Non-maskable interrupts
         LOC:      48687      45068      40188      65602   Local timer interrupts
         SPU:          0          0          0          0   Spurious interrupts
+
+        The file is read a large block at a time and split into records at
+        its "timestamp:" lines, converting the per-CPU counts of each line in
+        one go, and computing their rates together.
         """
+        toolname = self.toolname
         cpu_column_ids = None
         cpu_count = None
         ts_str = None
@@ -2458,27 +3709,30 @@ class ToolData(PbenchData):
         prev_gauges = _dict_const()
         idx = 0
         self.logger.info(
-            "tool-data-indexing: tool {}, stdout procint start {}", self.toolname, path
+            "tool-data-indexing: tool {}, stdout procint start {}", toolname, path
         )
-        for line in file_object:
-            if line.startswith("timestamp:"):
+        for header, body in _stdout_records(file_object):
+            lines = body.split("\n")
+            if lines[-1] == "":
+                lines.pop()
+            else:
+                # The last line of the file has no newline, but is still
+                # stripped of its last character.
+                lines[-1] = lines[-1][:-1]
+            if header is not None:
                 idx += 1
                 prev_ts_orig = ts_orig
-                # Get the second column, the timestamp value, which is
-                # *seconds* since the epoch, and then convert to millis
-                # since the epoch.
-                ts_orig = float(line.split(":")[1])
+                # The timestamp value is *seconds* since the epoch, which we
+                # convert to millis since the epoch.
+                ts_orig = float(header.split(":", 1)[0])
                 if prev_ts_orig is not None:
                     assert prev_ts_orig <= ts_orig, "prev_ts_orig %r > ts_orig %r" % (
                         prev_ts_orig,
                         ts_orig,
                     )
                 ts_str = self.mk_abs_timestamp_millis(ts_orig * 1000)
-                # The next line is assumed to be the header, so instead of
-                # looping to get to it, we just pull it out and process it
-                # here.
-                header = next(file_object)
-                columns = header.split()
+                # The next line is assumed to be the header.
+                columns = lines.pop(0).split()
                 cpu_column_ids = []
                 for cpu in columns:
                     if not cpu.startswith("CPU"):
@@ -2487,64 +3741,60 @@ class ToolData(PbenchData):
                         )
                     cpu_column_ids.append(cpu[3:])
                 cpu_count = len(cpu_column_ids)
-                continue
-            parts = line[:-1].split(None, 1 + cpu_count)
-            int_id = parts[0][:-1]
-            if int_id in ("ERR", "MIS"):
-                record = _dict_const()
-                record["@timestamp"] = ts_str
-                record["@timestamp_original"] = str(ts_orig)
-                record["run"] = self.run_metadata
-                record["iteration"] = self.iteration_metadata
-                record["sample"] = self.sample_metadata
-                record[self.toolname] = _dict_const()
-                record[self.toolname]["@idx"] = idx
-                record[self.toolname]["int_id"] = int_id
-                record[self.toolname]["gauge"] = value = converter(parts[1])
-                if int_id in prev_gauges:
-                    duration = ts_orig - prev_ts_orig
-                    value_diff = value - prev_gauges[int_id]
-                    the_rate = value_diff / duration
-                    record[self.toolname]["rate"] = the_rate
-                prev_gauges[int_id] = value
-                yield record
-            else:
+                ts_orig_str = str(ts_orig)
+                duration = None if prev_ts_orig is None else ts_orig - prev_ts_orig
+            for line in lines:
+                parts = line.split(None, 1 + cpu_count)
+                int_id = parts[0][:-1]
+                if int_id in ("ERR", "MIS"):
+                    record = _dict_const()
+                    record["@timestamp"] = ts_str
+                    record["@timestamp_original"] = ts_orig_str
+                    record["run"] = self.run_metadata
+                    record["iteration"] = self.iteration_metadata
+                    record["sample"] = self.sample_metadata
+                    record[toolname] = _dict_const()
+                    record[toolname]["@idx"] = idx
+                    record[toolname]["int_id"] = int_id
+                    record[toolname]["gauge"] = value = converter(parts[1])
+                    if int_id in prev_gauges:
+                        record[toolname]["rate"] = (
+                            value - prev_gauges[int_id]
+                        ) / duration
+                    prev_gauges[int_id] = value
+                    yield record
+                    continue
                 desc_str = parts[-1]
-                col = 1
-                records = []
-                cpu_gauges = []
-                for cpu in cpu_column_ids:
-                    val = converter(parts[col])
-                    col += 1
+                cpu_gauges = list(map(converter, parts[1 : 1 + cpu_count]))
+                if len(cpu_gauges) < cpu_count:
+                    # Fail just the same as when converting each count.
+                    converter(parts[1 + len(cpu_gauges)])
+                if int_id in prev_gauges and cpu_gauges:
+                    # The rates of all the CPUs are computed against the
+                    # previous count of the first CPU.
+                    prev_gauge = prev_gauges[int_id][0]
+                    rates = [(val - prev_gauge) / duration for val in cpu_gauges]
+                else:
+                    rates = None
+                for col, cpu in enumerate(cpu_column_ids):
                     record = _dict_const()
                     record["@timestamp"] = ts_str
-                    record["@timestamp_original"] = str(ts_orig)
+                    record["@timestamp_original"] = ts_orig_str
                     record["run"] = self.run_metadata
                     record["iteration"] = self.iteration_metadata
                     record["sample"] = self.sample_metadata
-                    record[self.toolname] = _dict_const()
-                    record[self.toolname]["@idx"] = idx
-                    record[self.toolname]["int_id"] = int_id
-                    record[self.toolname]["cpu_id"] = cpu
-                    record[self.toolname]["desc"] = desc_str
-                    record[self.toolname]["gauge"] = val
-                    records.append(record)
-                    cpu_gauges.append(val)
-                if int_id in prev_gauges:
-                    prev_cpu_gauges = prev_gauges[int_id]
-                    col = 0
-                    duration = ts_orig - prev_ts_orig
-                    for record in records:
-                        value_diff = (
-                            record[self.toolname]["gauge"] - prev_cpu_gauges[col]
-                        )
-                        the_rate = value_diff / duration
-                        record[self.toolname]["rate"] = the_rate
-                prev_gauges[int_id] = cpu_gauges
-                for record in records:
+                    record[toolname] = tool_rec = _dict_const()
+                    tool_rec["@idx"] = idx
+                    tool_rec["int_id"] = int_id
+                    tool_rec["cpu_id"] = cpu
+                    tool_rec["desc"] = desc_str
+                    tool_rec["gauge"] = cpu_gauges[col]
+                    if rates is not None:
+                        tool_rec["rate"] = rates[col]
                     yield record
+                prev_gauges[int_id] = cpu_gauges
         self.logger.info(
-            "tool-data-indexing: tool {}, stdout procint end {}", self.toolname, path
+            "tool-data-indexing: tool {}, stdout procint end {}", toolname, path
         )
         return
 
@@ -2587,7 +3837,7 @@ class ToolData(PbenchData):
             path = os.path.join(self.ptb.extracted_root, output_file["path"])
             with open(path, "r") as file_object:
                 for record in func(self, file_object, converter, output_file["path"]):
-                    source_id = PbenchData.make_source_id(record)
+                    source_id = self.make_tool_source_id(record)
                     yield record, source_id
 
     def _make_source_json(self):
@@ -2700,7 +3950,7 @@ class ToolData(PbenchData):
 
                 # Any further transformations needed should be done here.
 
-                source_id = PbenchData.make_source_id(source)
+                source_id = self.make_tool_source_id(source)
                 yield source, source_id
                 idx += 1
             self.logger.info(
@@ -3165,8 +4415,12 @@ class PbenchTarBall:
     pbench tar ball.
     """
 
-    def __init__(self, idxctx, username, tbarg, tmpdir, extracted_root):
+    def __init__(self, idxctx, username, tbarg, tmpdir, extracted_root, stats=None):
         self.idxctx = idxctx
+        # See mk_checkpoint().
+        self.checkpoint = None
+        # IndexingStats object, when collecting indexing statistics.
+        self.stats = stats
         self.authorization = {
             "owner": username,
             "access": "public" if username is None else "private",
@@ -3180,20 +4434,44 @@ class PbenchTarBall:
             self.controller_name = self.controller_dir
         tb_stat = os.stat(self.tbname)
         mtime = datetime.utcfromtimestamp(tb_stat.st_mtime)
-        self.tb = tarfile.open(self.tbname)
 
         # This is the top-level name of the run - it should be the common
         # first component of every member of the tar ball.
         dirname = os.path.basename(self.tbname)
         self.dirname = dirname[: dirname.rfind(".tar.xz")]
-        # ... but let's make sure ...
-        #
-        # ... while we are at it, we verify we have a metadata.log file in the
-        # tar ball before we start extracting.
+
+        # Prefer the manifest of the tar ball members recorded when it was
+        # unpacked, only decompressing the tar ball to list its members when
+        # there isn't one.
+        wall = time.perf_counter()
+        cpu = time.process_time()
+        self.members = self._load_manifest()
+        if self.members is None:
+            self.members = list_members(self.tbname)
+
+        # Make sure every member has the top-level name of the run as its
+        # first component, and, while we are at it, we verify we have a
+        # metadata.log file in the tar ball before we start extracting.
         metadata_log_path = "%s/metadata.log" % (self.dirname)
         metadata_log_found = False
-        self.members = self.tb.getmembers()
-        for m in self.members:
+        # Catalog of the tar ball members, built once so that lookups don't
+        # have to scan all the members: the sorted names of all the regular
+        # files, along with their position in the tar ball, for path prefix
+        # lookups; and the names of all the directories, keyed by the number
+        # of path elements in their name.  Such lookups are only possible
+        # when no file name repeats the top-level directory name past its
+        # start.
+        self._file_names = []
+        self._dirs_by_depth = defaultdict(list)
+        self._nested_dirname = False
+        dirname_prefix = f"{self.dirname}/"
+        for idx, m in enumerate(self.members):
+            if m.isfile():
+                self._file_names.append((m.name, idx))
+                if m.name.find(dirname_prefix, 1) >= 0:
+                    self._nested_dirname = True
+            elif m.isdir():
+                self._dirs_by_depth[len(m.name.split("/"))].append(m.name)
             if m.name == metadata_log_path:
                 metadata_log_found = True
             sampled_prefix = m.name.split(os.path.sep)[0]
@@ -3210,6 +4488,13 @@ class PbenchTarBall:
             raise UnsupportedTarballFormat(
                 '{} - tar ball is missing "{}".'.format(self.tbname, metadata_log_path)
             )
+        self._file_names.sort()
+        if stats is not None:
+            stats.add(
+                "tar-listing",
+                time.perf_counter() - wall,
+                time.process_time() - cpu,
+            )
 
         self.extracted_root = extracted_root
         if not os.path.isdir(os.path.join(self.extracted_root, self.dirname)):
@@ -3377,13 +4662,50 @@ class PbenchTarBall:
         # additional context to add.
         self._tbctx = f"{self.controller_dir}/{os.path.basename(tbarg)}({md5sum})"
 
+    def _load_manifest(self):
+        """Load the members of the tar ball from the manifest recorded next to
+        it, returning None if there is no usable manifest.
+
+        The manifest is only used if it was recorded for this tar ball, as
+        identified by its name and MD5 sum.
+        """
+        path = manifest_path(self.tbname)
+        if not os.path.isfile(path):
+            return None
+        try:
+            md5sum = open("%s.md5" % (self.tbname)).read().split()[0]
+            return load_manifest(path, os.path.basename(self.tbname), md5sum)
+        except (OSError, IndexError, ManifestError) as e:
+            self.idxctx.logger.warning(
+                "Ignoring member manifest {}: {}", path, e,
+            )
+            return None
+
     def gen_files_by_partial_path(self, path):
         """Generator for all files in the tar ball which match the given path
-        pattern.
+        pattern, in the order they appear in the tar ball.
+
+        All the members of the tar ball begin with its top-level directory
+        name, so a path which begins with it as well is matched at the start
+        of a member's name, allowing the matching files to be found
+        with a binary search of the sorted file names instead of a scan of
+        all the members (unless a file name repeats the top-level directory
+        name, where the path could match further along).
         """
-        for member in self.members:
-            if member.isfile() and member.name.find(path) >= 0:
-                yield member.name
+        if self._nested_dirname or not path.startswith(f"{self.dirname}/"):
+            for member in self.members:
+                if member.isfile() and member.name.find(path) >= 0:
+                    yield member.name
+            return
+        file_names = self._file_names
+        i = bisect.bisect_left(file_names, (path,))
+        matches = []
+        while i < len(file_names) and file_names[i][0].startswith(path):
+            matches.append(file_names[i])
+            i += 1
+        matches.sort(key=itemgetter(1))
+        for name, _ in matches:
+            yield name
 
     _iter_num_pat = re.compile(r"(?P<num>^[1-9][0-9]*)-")
 
@@ -3413,16 +4735,10 @@ class PbenchTarBall:
             # through the tar ball members looking for directories that are
             # most likely iterations.
             iterations = []
-            for member in self.members:
-                if not member.isdir():
-                    # We are only looking for directories
-                    continue
-                path_els = member.name.split("/")
-                if len(path_els) != 2:
-                    # Iteration directory names always have 2 path elements,
-                    # [ '/', '<iteration name>' ].
-                    continue
-                itername = path_els[1]
+            # Iteration directory names always have 2 path elements,
+            # [ '/', '<iteration name>' ].
+            for name in self._dirs_by_depth[2]:
+                itername = name.split("/")[1]
                 if self._iter_num_pat.match(itername):
                     # We only recognize iteration names that match this
                     # pattern, as later versions of the pbench-agent have
@@ -3444,18 +4760,12 @@ class PbenchTarBall:
         """Get the list of Sample objects for a given iteration object.
         """
         samples = []
-        for member in self.members:
-            if not member.isdir():
-                # We are only looking for directories
-                continue
-            if member.name.find(f"{iteration.name}/") < 0:
-                continue
-            path_els = member.name.split("/")
-            if len(path_els) != 3:
-                # Sample directory names always have 3 path elements,
-                # [ '/', '<iteration name>', 'sample<number>' ].
+        # Sample directory names always have 3 path elements,
+        # [ '/', '<iteration name>', 'sample<number>' ].
+        for name in self._dirs_by_depth[3]:
+            if name.find(f"{iteration.name}/") < 0:
                 continue
-            sample = path_els[2]
+            sample = name.split("/")[2]
             if sample.startswith("sample"):
                 # Sample directories always begin with 'sample'.
                 samples.append(sample)
@@ -3568,14 +4878,56 @@ class PbenchTarBall:
         result data.
         """
         self.idxctx.logger.debug("start")
-        yield self.mk_run_action()
-        for action in self.mk_toc_actions():
-            yield action
-        for action in self.mk_result_data_actions():
-            yield action
+        if self._unit_done(("run",)):
+            self.idxctx.logger.debug("skipping run and table-of-contents documents")
+        else:
+            yield self.mk_run_action()
+            for action in self.mk_toc_actions():
+                yield action
+            self._unit_finished(("run",))
+        if self._unit_done(("results",)):
+            self.idxctx.logger.debug("skipping result data documents")
+        else:
+            for action in self.mk_result_data_actions():
+                yield action
+            self._unit_finished(("results",))
         self.idxctx.logger.debug("end")
         return
 
+    def mk_single_pass_actions(self):
+        """Generate the actions for all the documents of the tar ball in a
+        single pass: those of make_all_actions() followed by those of
+        mk_tool_data_actions(), as one stream for bulk indexing.
+        """
+        yield from self.make_all_actions()
+        yield from self.mk_tool_data_actions()
+
+    def mk_checkpoint(self, tool_data, value=None, single_pass=False):
+        """Start tracking the units of documents indexed from this tar ball,
+        for either the tool data pass or the other pass, or for a single pass
+        indexing both, resuming from the given encoded checkpoint (see
+        IndexingCheckpoint), if any.
+
+        The tool data units are the (iteration, sample, host, tool) tuples,
+        while the run, table-of-contents, and result data documents form two
+        units of their own.  The action generators skip the units already
+        done.
+        """
+        units = []
+        if single_pass or not tool_data:
+            units.extend([("run",), ("results",)])
+        if single_pass or tool_data:
+            units.extend(self._tool_data_units())
+        self.checkpoint = IndexingCheckpoint(units, value)
+        return self.checkpoint
+
+    def _unit_done(self, unit):
+        return self.checkpoint is not None and self.checkpoint.is_done(unit)
+
+    def _unit_finished(self, unit):
+        if self.checkpoint is not None:
+            self.checkpoint.unit_finished(unit)
+
     def mk_run_action(self):
         """Extract metadata from the named tar ball and create an indexing
         action out of them.
@@ -3804,78 +5156,81 @@ class PbenchTarBall:
             ] }
         """
         prefix_l = len(self.dirname)
-        # Note we have to fully populate the dictionary by processing all the
-        # members before we can yield the generated sources for each
-        # directory.
-        toc_dirs = _dict_const()
-        for m in self.members:
+        # Rather than building the documents for all the directories before
+        # yielding the first one, we only index the members belonging to each
+        # directory, by their position in the tar ball, and then build and
+        # yield the documents one directory at a time, in sorted directory
+        # order, so that only one document is held in memory at any time.
+        # The first member of each directory is its own entry.
+        dir_members = {}
+        for idx, m in enumerate(self.members):
             # Always strip the prefix
             path = m.name[prefix_l:]
             if m.isdir():
                 if path == "/" or path == "":
                     dpath = "/"
-                    name = None
-                    parent = "/"
-                    path_els = []
                 else:
                     dpath = path[:-1] if path.endswith(os.path.sep) else path
-                    name = os.path.basename(dpath)
-                    parent = os.path.dirname(dpath)
-                    path_els = dpath.split(os.path.sep)[1:-1]
-                if dpath in toc_dirs:
+                if dpath in dir_members:
                     raise Exception(
                         "Logic bomb! Found a directory entry that already exists!"
                     )
-                toc_dirs[dpath] = _dict_const(
-                    parent=parent,
-                    directory=dpath,
-                    mtime=datetime.utcfromtimestamp(float(m.mtime)).isoformat(),
-                    mode=oct(m.mode),
-                )
-                if name:
-                    toc_dirs[dpath]["name"] = name
-                if len(path_els) > 0:
-                    toc_dirs[dpath]["ancestor_path_elements"] = path_els
+                dir_members[dpath] = array("L", (idx,))
             else:
-                fentry = _dict_const(
-                    name=os.path.basename(path),
-                    mtime=datetime.utcfromtimestamp(float(m.mtime)).isoformat(),
-                    size=m.size,
-                    mode=oct(m.mode),
-                )
-                try:
-                    ftype = self._mode_table[m.type]
-                except KeyError:
-                    ftype = "unk"
-                fentry["type"] = ftype
-                if m.issym():
-                    fentry["linkpath"] = m.linkpath
-                dpath = os.path.dirname(path)
-                # we may have created an empty dir entry already without a
-                # 'files' entry, so we now make sure that there is an
-                # empty 'files' entry that we can populate.
-                if "files" not in toc_dirs[dpath]:
-                    toc_dirs[dpath]["files"] = []
-                toc_dirs[dpath]["files"].append(fentry)
-        for key in sorted(toc_dirs.keys()):
-            source = toc_dirs[key]
-            try:
-                sorted_file_list = sorted(
-                    source["files"], key=itemgetter("name", "mtime")
-                )
-            except KeyError:
-                pass
+                dir_members[os.path.dirname(path)].append(idx)
+        for dpath in sorted(dir_members.keys()):
+            idxs = dir_members.pop(dpath)
+            m = self.members[idxs[0]]
+            if dpath == "/":
+                name = None
+                parent = "/"
+                path_els = []
             else:
-                source["files"] = sorted_file_list
+                name = os.path.basename(dpath)
+                parent = os.path.dirname(dpath)
+                path_els = dpath.split(os.path.sep)[1:-1]
+            source = _dict_const(
+                parent=parent,
+                directory=dpath,
+                mtime=datetime.utcfromtimestamp(float(m.mtime)).isoformat(),
+                mode=oct(m.mode),
+            )
+            if name:
+                source["name"] = name
+            if len(path_els) > 0:
+                source["ancestor_path_elements"] = path_els
+            if len(idxs) > 1:
+                source["files"] = sorted(
+                    (self._toc_file_entry(self.members[i], prefix_l) for i in idxs[1:]),
+                    key=itemgetter("name", "mtime"),
+                )
 
             # Add "join" metadata to connect TOC doc to parent run doc
             source["run_data_parent"] = self.run_metadata["id"]
             source["authorization"] = self.authorization
             yield source
 
-    def mk_tool_data(self):
-        """Yield ToolData() objects for each tool directory found in the
-        hierarhcy.
+    def _toc_file_entry(self, m, prefix_l):
+        """Return the table-of-contents entry of a non-directory member."""
+        path = m.name[prefix_l:]
+        fentry = _dict_const(
+            name=os.path.basename(path),
+            mtime=datetime.utcfromtimestamp(float(m.mtime)).isoformat(),
+            size=m.size,
+            mode=oct(m.mode),
+        )
+        try:
+            ftype = self._mode_table[m.type]
+        except KeyError:
+            ftype = "unk"
+        fentry["type"] = ftype
+        if m.issym():
+            fentry["linkpath"] = m.linkpath
+        return fentry
+
+    def _tool_data_units(self):
+        """Yield the (iteration, sample, host, tool) tuples naming each unit
+        of tool data found in the hierarchy.
 
         Tool data are stored in various files in the tar ball under a specific
         hierarchy.  The structure looks like the following:
@@ -3906,45 +5261,165 @@ class PbenchTarBall:
                     tool_names = list(tools_data.keys())
                     tool_names.sort()
                     for tool in tool_names:
-                        yield ToolData(
-                            self, iteration.name, sample.name, hostname, tool
-                        )
+                        yield iteration.name, sample.name, hostname, tool
+        return
+
+    def _pending_tool_data_units(self):
+        """Yield the units of tool data not already done, see mk_checkpoint().
+        """
+        for unit in self._tool_data_units():
+            if self._unit_done(unit):
+                self.idxctx.logger.debug("skipping tool data unit {!r}", unit)
+            else:
+                yield unit
+
+    def mk_tool_data(self):
+        """Yield ToolData() objects for each tool directory found in the
+        hierarhcy.
+        """
+        for iteration, sample, hostname, tool in self._tool_data_units():
+            yield ToolData(self, iteration, sample, hostname, tool)
         return
 
+    @staticmethod
+    def _tool_data_sources(td):
+        """Yield the (index name, source, source ID) tuples for all the
+        documents generated by the given ToolData object.
+        """
+        # Each ToolData object, td, that is returned here represents how
+        # data collected for that tool across all hosts is to be returned.
+        # The make_source method returns a generator that will emit each
+        # source document for the appropriate unit of tool data.  Each has
+        # the option of constructing that data as best fits its tool data.
+        # The tool data for each tool is kept in its own index to allow
+        # for different curation policies for each tool.
+        #
+        # When configured, the rollups of the tool data follow it.
+        asource = td.make_source()
+        if not asource:
+            return
+        rollup = ToolDataRollup(td) if td.idxctx.tool_data_rollups else None
+        for source, source_id in asource:
+            try:
+                idx_name = td.generate_index_name(
+                    "tool-data", source, toolname=td.toolname
+                )
+            except BadDate:
+                pass
+            else:
+                if rollup is not None:
+                    rollup.add(source)
+                yield idx_name, source, source_id
+        if rollup is not None:
+            yield from rollup.sources()
+
+    def _unit_tool_data_sources(self, unit):
+        """Yield the tool data documents of the given unit of tool data, see
+        _tool_data_sources().
+        """
+
+        def sources():
+            yield from self._tool_data_sources(ToolData(self, *unit))
+
+        if self.stats is None:
+            return sources()
+        # The tool data handler is that of the unit's tool.
+        return self.stats.timed_tool_data(unit[3], sources())
+
+    def _mk_tool_data_sources_serial(self):
+        for unit in self._pending_tool_data_units():
+            yield from self._unit_tool_data_sources(unit)
+            self._unit_finished(unit)
+
+    def _mk_tool_data_sources_parallel(self, workers):
+        """Fan out the generation of the tool data documents to a number of
+        worker processes, each pulling units of tool data to process from a
+        shared queue, and yield the documents they send back through a
+        bounded queue as they arrive.
+
+        The documents are the same as those generated serially, but their
+        order is not.
+        """
+        mpctx = multiprocessing.get_context("fork")
+        units = mpctx.Queue()
+        for unit in self._pending_tool_data_units():
+            units.put(unit)
+        for _ in range(workers):
+            units.put(None)
+        results = mpctx.Queue(maxsize=workers * _TOOL_DATA_QUEUE_CHUNKS)
+        procs = [
+            mpctx.Process(target=_tool_data_worker, args=(self, units, results))
+            for _ in range(workers)
+        ]
+        for proc in procs:
+            proc.start()
+        try:
+            running = workers
+            while running > 0:
+                try:
+                    kind, payload = results.get(timeout=1)
+                except queue.Empty:
+                    if not any(proc.is_alive() for proc in procs) and results.empty():
+                        raise Exception("tool data worker exited unexpectedly")
+                    continue
+                if kind == "docs":
+                    yield from payload
+                elif kind == "unit":
+                    # All the documents of the unit have been yielded.
+                    self._unit_finished(payload)
+                elif kind == "error":
+                    raise payload
+                else:
+                    # The worker is done, record its operational context and
+                    # statistics.
+                    running -= 1
+                    opctx, stats = payload
+                    self.idxctx.opctx.extend(opctx)
+                    if stats is not None:
+                        self.stats.merge(stats)
+        finally:
+            for proc in procs:
+                if proc.is_alive():
+                    proc.terminate()
+            for proc in procs:
+                proc.join()
+
     def mk_tool_data_actions(self):
         """Generate all the tool data actions from the entire run hierarchy.
+
+        When configured with more than one tool data worker, the documents are
+        generated by a pool of processes instead of serially.  Since the pool
+        cannot be created from within a daemonic process (e.g. a tar ball
+        indexing pool worker), tool data is always generated serially there.
         """
         self.idxctx.logger.debug("start")
         count = 0
-        for td in self.mk_tool_data():
-            # Each ToolData object, td, that is returned here represents how
-            # data collected for that tool across all hosts is to be returned.
-            # The make_source method returns a generator that will emit each
-            # source document for the appropriate unit of tool data.  Each has
-            # the option of constructing that data as best fits its tool data.
-            # The tool data for each tool is kept in its own index to allow
-            # for different curation policies for each tool.
-            asource = td.make_source()
-            if not asource:
-                continue
-            for source, source_id in asource:
-                try:
-                    idx_name = td.generate_index_name(
-                        "tool-data", source, toolname=td.toolname
-                    )
-                except BadDate:
-                    pass
-                else:
-                    source["@generated-by"] = self.idxctx.get_tracking_id()
-                    source["authorization"] = self.authorization
-                    action = _dict_const(
-                        _op_type=_op_type,
-                        _index=idx_name,
-                        _id=source_id,
-                        _source=source,
-                    )
-                    count += 1
-                    yield action
+        workers = self.idxctx.tool_data_workers
+        if workers > 1 and not multiprocessing.current_process().daemon:
+            sources = self._mk_tool_data_sources_parallel(workers)
+        else:
+            sources = self._mk_tool_data_sources_serial()
+        # Compact JSON encoding of the fields added to every document, for
+        # splicing into the end of already encoded source documents.
+        encode = json.JSONEncoder(separators=(",", ":")).encode
+        encoded_suffix = ',"@generated-by":{},"authorization":{}}}'.format(
+            encode(self.idxctx.get_tracking_id()), encode(self.authorization)
+        )
+        for idx_name, source, source_id in sources:
+            encoded = getattr(source_id, "encoded", None)
+            if encoded is not None:
+                # Re-use the encoding the document ID was computed from as
+                # the body of the document.
+                source = encoded[:-1] + encoded_suffix
+                source_id = str(source_id)
+            else:
+                source["@generated-by"] = self.idxctx.get_tracking_id()
+                source["authorization"] = self.authorization
+            action = _dict_const(
+                _op_type=_op_type, _index=idx_name, _id=source_id, _source=source,
+            )
+            count += 1
+            yield action
         self.idxctx.logger.debug("end [{:d} tool data documents]", count)
         return
 
@@ -3989,6 +5464,46 @@ class PbenchTarBall:
         return
 
 
+def _tool_data_worker(ptb, units, results):
+    """Generate the tool data documents for each unit of tool data pulled
+    from the "units" queue, sending them to the parent process in chunks via
+    the bounded "results" queue.
+
+    Runs in a forked process, so the PbenchTarBall object is inherited
+    as-is.  Each unit is reported to the parent once all of its documents
+    have been sent, for checkpointing.  The operational context and the
+    indexing statistics (if collected) accumulated by this worker are sent
+    back to the parent when it is done.
+    """
+    signal.signal(signal.SIGINT, signal.SIG_IGN)
+    signal.signal(signal.SIGQUIT, signal.SIG_IGN)
+    signal.signal(signal.SIGHUP, signal.SIG_IGN)
+    signal.signal(signal.SIGTERM, signal.SIG_DFL)
+    opctx_len = len(ptb.idxctx.opctx)
+    if ptb.stats is not None:
+        # Only this worker's statistics are sent back to the parent.
+        ptb.stats = IndexingStats()
+    try:
+        for unit in iter(units.get, None):
+            chunk = []
+            for doc in ptb._unit_tool_data_sources(unit):
+                chunk.append(doc)
+                if len(chunk) >= _TOOL_DATA_CHUNK_SIZE:
+                    results.put(("docs", chunk))
+                    chunk = []
+            if chunk:
+                results.put(("docs", chunk))
+            results.put(("unit", unit))
+    except Exception as exc:
+        try:
+            pickle.dumps(exc)
+        except Exception:
+            exc = Exception(repr(exc))
+        results.put(("error", exc))
+    finally:
+        results.put(("done", (ptb.idxctx.opctx[opctx_len:], ptb.stats)))
+
+
 class IdxContext:
     """
     The general indexing options, including configuration and other external
@@ -4011,6 +5526,126 @@ class IdxContext:
                     "Index prefix, '{}', not allowed to"
                     " contain a period ('.')".format(self.idx_prefix)
                 )
+        # Number of tar balls indexed concurrently; a value of 1 keeps the
+        # original, serial behavior of processing one tar ball at a time.
+        self.workers = self._get_indexing_int("workers", 1, minimum=1)
+        # Number of processes generating tool data documents for a tar ball;
+        # a value of 1 generates them serially.
+        self.tool_data_workers = self._get_indexing_int(
+            "tool_data_workers", 1, minimum=1
+        )
+        # Strategy used to generate tool data document IDs, see
+        # _source_id_strategies.
+        try:
+            self.document_ids = self.config.get("Indexing", "document_ids")
+        except (NoOptionError, NoSectionError):
+            self.document_ids = "legacy"
+        if self.document_ids not in _source_id_strategies:
+            raise ConfigFileError(
+                "Indexing document_ids, '{}', must be one of {}".format(
+                    self.document_ids, ", ".join(sorted(_source_id_strategies))
+                )
+            )
+        # Whether to encode tool data documents for bulk requests ourselves
+        # (always the case for the "fast" document IDs).
+        try:
+            self.preencoded_bodies = self.config.conf.getboolean(
+                "Indexing", "preencoded_bodies"
+            )
+        except (NoOptionError, NoSectionError):
+            self.preencoded_bodies = False
+        except ValueError as e:
+            raise ConfigFileError(str(e))
+        # Number of bulk requests kept in flight while indexing a tar ball; a
+        # value of 1 streams the actions through a single bulk request at a
+        # time.  Otherwise, the size of each request adapts to keep them
+        # within the target latency (seconds), and a request is abandoned,
+        # and retried, after the request timeout (seconds).
+        self.bulk_requests = self._get_indexing_int("bulk_requests", 1, minimum=1)
+        self.bulk_target_latency = self._get_indexing_int(
+            "bulk_target_latency", 10, minimum=1
+        )
+        self.bulk_request_timeout = self._get_indexing_int(
+            "bulk_request_timeout", 600, minimum=1
+        )
+        # Number of actions indexed between checkpoints of the units of a tar
+        # ball fully indexed, allowing an interrupted tar ball to be resumed;
+        # a value of 0 disables checkpoints.
+        self.checkpoint_actions = self._get_indexing_int(
+            "checkpoint_actions", 0, minimum=0
+        )
+        # Whether to collect the time spent in, and the documents generated
+        # by, each phase of indexing, and post them as server reports.
+        try:
+            self.phase_stats = self.config.conf.getboolean("Indexing", "phase_stats")
+        except (NoOptionError, NoSectionError):
+            self.phase_stats = False
+        except ValueError as e:
+            raise ConfigFileError(str(e))
+        # Whether to also index rollups of the tool data (see ToolDataRollup)
+        # into the tool data rollup indices.
+        try:
+            self.tool_data_rollups = self.config.conf.getboolean(
+                "Indexing", "tool_data_rollups"
+            )
+        except (NoOptionError, NoSectionError):
+            self.tool_data_rollups = False
+        except ValueError as e:
+            raise ConfigFileError(str(e))
+        # Directory in which to record the documents indexed for each tar
+        # ball, see IndexedIds; when not given, documents are always sent.
+        try:
+            self.indexed_ids_dir = (
+                self.config.get("Indexing", "indexed_ids_dir") or None
+            )
+        except (NoOptionError, NoSectionError):
+            self.indexed_ids_dir = None
+        # How the tar balls waiting to be indexed are scheduled, see
+        # IndexingQueue: whether to use fair scheduling, the largest size of
+        # the tar balls in its fast lane, the number of bytes of tar balls
+        # each lane may start per invocation, and the time (seconds) after
+        # which an invocation starts no more tar balls (0 for no limit).
+        try:
+            self.fair_scheduling = self.config.conf.getboolean(
+                "Indexing", "fair_scheduling"
+            )
+        except (NoOptionError, NoSectionError):
+            self.fair_scheduling = False
+        except ValueError as e:
+            raise ConfigFileError(str(e))
+        self.fast_lane_size = self._get_indexing_int(
+            "fast_lane_size", 16 * 1024 * 1024, minimum=0
+        )
+        self.fast_lane_bytes = self._get_indexing_int("fast_lane_bytes", 0, minimum=0)
+        self.slow_lane_bytes = self._get_indexing_int("slow_lane_bytes", 0, minimum=0)
+        self.time_budget = self._get_indexing_int("time_budget", 0, minimum=0)
+        # Whether to index the tool data of a tar ball in the same pass as its
+        # run, table-of-contents, and result data, moving it straight to the
+        # INDEXED state, instead of in a separate "--tool-data" pass.
+        try:
+            self.single_pass = self.config.conf.getboolean("Indexing", "single_pass")
+        except (NoOptionError, NoSectionError):
+            self.single_pass = False
+        except ValueError as e:
+            raise ConfigFileError(str(e))
+        # Whether to read the result.json files of the result data one
+        # iteration at a time, instead of as a whole.
+        try:
+            self.streaming_results = self.config.conf.getboolean(
+                "Indexing", "streaming_results"
+            )
+        except (NoOptionError, NoSectionError):
+            self.streaming_results = False
+        except ValueError as e:
+            raise ConfigFileError(str(e))
+        # Whether to cache the loaded templates in the server's temporary
+        # directory, so that later invocations need not load them again.
+        try:
+            template_cache = self.config.conf.getboolean("Indexing", "template_cache")
+        except (NoOptionError, NoSectionError):
+            template_cache = False
+        except ValueError as e:
+            raise ConfigFileError(str(e))
 
         # We expose the pbench.server module's internal _time() method here
         # for convenience, allowing us to more easily mock out "time" for unit
@@ -4049,16 +5684,40 @@ class IdxContext:
         self.TS = self.config.TS
 
         self.logger = get_pbench_logger(self.name, self.config)
-        self.es = get_es(self.config, self.logger)
+        self.es = get_es(self.config, self.logger, self.bulk_requests)
         self.templates = PbenchTemplates(
             self.config.BINDIR,
             self.idx_prefix,
             self.logger,
             _known_tool_handlers,
             _dbg=_dbg,
+            tool_data_rollups=self.tool_data_rollups,
+            cache_dir=str(self.config.TMP) if template_cache else None,
         )
         self.tracking_id = None
 
+    def _get_indexing_int(self, option, default, minimum=None):
+        """Fetch an optional integer value from the [Indexing] section of the
+        configuration, returning the given default if it is not present.
+        """
+        try:
+            val = self.config.get("Indexing", option)
+        except (NoOptionError, NoSectionError):
+            return default
+        try:
+            ival = int(val)
+        except ValueError:
+            raise ConfigFileError(
+                "Indexing option '{}', '{}', is not an integer".format(option, val)
+            )
+        if minimum is not None and ival < minimum:
+            raise ConfigFileError(
+                "Indexing option '{}', '{:d}', must be at least {:d}".format(
+                    option, ival, minimum
+                )
+            )
+        return ival
+
     def dump_opctx(self):
         counters_list = []
         for ctx in self.opctx:
@@ -0,0 +1,167 @@
+"""Scheduling of the tar balls waiting to be indexed.
+
+By default, tar balls are indexed smallest first, in a single queue.
+
+With "fair" scheduling, the tar balls are split into two lanes by size.
+The fast lane holds the small tar balls and is always served first. The
+slow lane holds the rest. Within each lane the controllers take turns,
+each contributing its smallest tar ball, so one controller uploading many
+runs can't starve the others. When tar balls are indexed by a pool of
+workers, one worker is kept for the fast lane, so small tar balls are
+never stuck behind huge ones.
+
+Each lane can be capped to a number of bytes of tar balls started per
+invocation. An invocation can also be given a time budget, after which no
+further tar balls are started. Any tar balls left over are picked up by
+the next invocation.
+"""
+
+import os
+import time
+from collections import OrderedDict, deque
+
+
+class _Lane:
+    """The tar balls of one lane, by controller, smallest first, with the
+    controllers in the order of their turns.
+    """
+
+    def __init__(self, name, byte_cap):
+        self.name = name
+        self.byte_cap = byte_cap
+        self.started_bytes = 0
+        self.controllers = OrderedDict()
+
+    def __len__(self):
+        return sum(len(tbs) for tbs in self.controllers.values())
+
+    def add(self, key, item):
+        try:
+            self.controllers[key].append(item)
+        except KeyError:
+            self.controllers[key] = deque((item,))
+
+    def capped(self):
+        return self.byte_cap > 0 and self.started_bytes >= self.byte_cap
+
+    def pop(self):
+        """Return the smallest tar ball of the controller whose turn it is,
+        moving the controller to the back of the line.
+        """
+        key, tbs = next(iter(self.controllers.items()))
+        item = tbs.popleft()
+        del self.controllers[key]
+        if tbs:
+            self.controllers[key] = tbs
+        self.started_bytes += item[0]
+        return item
+
+
+class IndexingQueue:
+    """The queue of (size, controller, tar ball) tuples to be indexed, as
+    returned by Index.collect_tb().
+
+    Without fair scheduling all the tar balls share one lane and are taken
+    smallest first.  With it, the tar balls of at most "fast_lane_size"
+    bytes go to the fast lane, and the controllers take turns within each
+    lane.  A lane stops handing out tar balls once "<lane>_bytes" bytes
+    of them have been started (0 for no cap), and the whole queue once the
+    time budget (seconds, 0 for none) has elapsed.  With more than one
+    worker, at most "workers - 1" slow lane tar balls are in flight at
+    once.
+    """
+
+    def __init__(
+        self,
+        tarballs,
+        fair=False,
+        fast_lane_size=0,
+        fast_lane_bytes=0,
+        slow_lane_bytes=0,
+        time_budget=0,
+        workers=1,
+        record_waits=False,
+        clock=time.monotonic,
+    ):
+        self.fair = fair
+        self.fast_lane_size = fast_lane_size
+        self.record_waits = record_waits
+        self._clock = clock
+        self._deadline = clock() + time_budget if time_budget > 0 else None
+        self._slow_workers = workers - 1 if fair and workers > 1 else None
+        self._fast = _Lane("fast", fast_lane_bytes if fair else 0)
+        self._slow = _Lane("slow", slow_lane_bytes if fair else 0)
+        self.reset(tarballs)
+
+    def reset(self, tarballs):
+        """Replace the tar balls waiting to be indexed, e.g. once the list of
+        tar balls is collected again; the bytes started by each lane, and
+        the time budget, still count.
+        """
+        self._fast.controllers.clear()
+        self._slow.controllers.clear()
+        for item in sorted(tarballs):
+            size, controller, _ = item
+            if self.fair:
+                self._lane(size).add(controller, item)
+            else:
+                self._slow.add(None, item)
+
+    def _lane(self, size):
+        return self._fast if self.fair and size <= self.fast_lane_size else self._slow
+
+    def __len__(self):
+        return len(self._fast) + len(self._slow)
+
+    def __iter__(self):
+        for lane in (self._fast, self._slow):
+            for tbs in lane.controllers.values():
+                yield from tbs
+
+    def expired(self):
+        return self._deadline is not None and self._clock() >= self._deadline
+
+    def next_tarball(self, in_flight=()):
+        """Return the next (size, controller, tar ball) to index, given the
+        sizes of the tar balls in flight, or None if none may be started
+        now.
+        """
+        if self.expired():
+            return None
+        slow_ok = self._slow_workers is None or (
+            sum(1 for size in in_flight if self._lane(size) is self._slow)
+            < self._slow_workers
+        )
+        for lane in (self._fast, self._slow):
+            if lane is self._slow and not slow_ok:
+                break
+            if len(lane) > 0 and not lane.capped():
+                return lane.pop()
+        return None
+
+    def deferral_reason(self):
+        """Return why the tar balls still waiting won't be indexed by this
+        invocation, or None if they may be.
+        """
+        if len(self) == 0:
+            return None
+        if self.expired():
+            return "time budget exhausted"
+        waiting = [lane for lane in (self._fast, self._slow) if len(lane) > 0]
+        if all(lane.capped() for lane in waiting):
+            return "{} lane size cap reached".format(
+                " and ".join(lane.name for lane in waiting)
+            )
+        return None
+
+    def queue_wait(self, tb):
+        """Return how long (seconds) the given tar ball has been waiting to be
+        indexed, since its symlink was placed in the directory it is being
+        indexed from, or None if waits are not recorded.
+        """
+        if not self.record_waits:
+            return None
+        try:
+            return max(0.0, time.time() - os.lstat(tb).st_ctime)
+        except OSError:
+            return None
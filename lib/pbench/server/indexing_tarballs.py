@@ -2,10 +2,14 @@
 
 import os
 import glob
+import queue
 import signal
 import tempfile
+import time
+import functools
+import multiprocessing
 from pathlib import Path
-from collections import deque
+from itertools import islice
 
 from pbench.common.exceptions import (
     BadDate,
@@ -15,21 +19,34 @@ from pbench.common.exceptions import (
 )
 from pbench.server import tstos
 from pbench.server.indexer import (
+    IndexedIds,
+    IndexingStats,
     PbenchTarBall,
     es_index,
+    get_es,
     VERSION,
 )
+from pbench.server.indexing_queue import IndexingQueue
+from pbench.server.database.database import Database
 from pbench.server.database.models.tracker import (
     Dataset,
     States,
     Metadata,
+    DatasetError,
     DatasetNotFound,
     DatasetTransitionError,
+    MetadataError,
+    MetadataNotFound,
 )
 from pbench.server.report import Report
 from pbench.server.utils import rename_tb_link, quarantine
 
 
+# Maximum length of a Metadata value, bounding the size of indexing
+# checkpoints.
+_CHECKPOINT_MAX_LEN = 2048
+
+
 class SigIntException(Exception):
     pass
 
@@ -70,6 +87,81 @@ def _count_lines(fname):
     return cnt
 
 
+# The Index object on whose behalf the pool of indexing workers operates; it
+# is set by the parent before the pool is created so that the forked workers
+# inherit it.
+_pool_index = None
+
+
+def _pool_init():
+    """Initialize an indexing pool worker process.
+
+    The parent process handles SIGINT, SIGQUIT and SIGHUP on behalf of the
+    pool, and terminates the workers on SIGTERM.  Each worker also needs its
+    own connection to Elasticsearch, rather than sharing the parent's, and,
+    to record indexing checkpoints, its own connection to the database.
+    """
+    signal.signal(signal.SIGINT, signal.SIG_IGN)
+    signal.signal(signal.SIGQUIT, signal.SIG_IGN)
+    signal.signal(signal.SIGHUP, signal.SIG_IGN)
+    signal.signal(signal.SIGTERM, signal.SIG_DFL)
+    idxctx = _pool_index.idxctx
+    idxctx.es = get_es(idxctx.config, idxctx.logger, idxctx.bulk_requests)
+    if idxctx.checkpoint_actions > 0:
+        Database.init_db(idxctx.config, idxctx.logger)
+
+
+def _pool_index_tb(path, controller, username, tmpdir, ie_filepath):
+    """Index one tar ball in a pool worker process.
+
+    Returns the name of the resulting error code, the es_index() result
+    tuple (None if indexing did not complete), and the IndexingStats object
+    for the tar ball (None if not collected).
+    """
+    index = _pool_index
+    idxctx = index.idxctx
+    es_res = None
+    stats = IndexingStats() if idxctx.phase_stats else None
+    try:
+        dataset = None
+        if idxctx.checkpoint_actions > 0:
+            try:
+                dataset = Dataset.attach(path=path)
+            except DatasetError as e:
+                idxctx.logger.warning("Unable to checkpoint {}: {}", path, e)
+        es_res = index._index_tb(
+            idxctx,
+            path,
+            controller,
+            username,
+            tmpdir,
+            Path(ie_filepath),
+            False,
+            dataset=dataset,
+            stats=stats,
+        )
+    except Exception as e:
+        tb_res = index._tb_error(idxctx, e)
+    else:
+        tb_res = index._tb_indexed(idxctx, es_res)
+    finally:
+        # The operational context of this worker is not seen by the parent.
+        idxctx.dump_opctx()
+        idxctx.opctx.clear()
+    return tb_res.name, es_res, stats
+
+
+def _pool_done(results, tb, res):
+    results.put((tb, *res))
+
+
+def _pool_failed(results, tb, exc):
+    _pool_index.idxctx.logger.error(
+        "Indexing worker failed on {}: {!r}", tb, exc,
+    )
+    results.put((tb, "GENERIC_ERROR", None, None))
+
+
 class Index:
     """ class used to collect tarballs and index them
 
@@ -113,6 +205,11 @@ class Index:
             # when it only indexes tool data.
             self.linksrc = "TO-INDEX-TOOL"
             self.linkdest = "INDEXED"
+        elif idxctx.single_pass:
+            # The link source and destination for the operation of this script
+            # when it indexes all the data of the tar balls in a single pass.
+            self.linksrc = f"TO-{_re_idx}INDEX"
+            self.linkdest = "INDEXED"
         else:
             # The link source and destination for the operation of this script
             # when it indexes run, table-of-contents, and result data.
@@ -135,8 +232,19 @@ class Index:
         idxctx = self.idxctx
         error_code = self.error_code
         try:
-            tb_glob = os.path.join(self.archive, "*", self.linksrc, "*.tar.xz")
-            for tb in glob.iglob(tb_glob):
+            given = getattr(self.options, "tarballs", None)
+            if given:
+                # Only the given links, as long as they are still in
+                # $linksrc.
+                tbs = (
+                    tb
+                    for tb in given
+                    if Path(tb).parent.name == self.linksrc and Path(tb).is_symlink()
+                )
+            else:
+                tb_glob = os.path.join(self.archive, "*", self.linksrc, "*.tar.xz")
+                tbs = glob.iglob(tb_glob)
+            for tb in tbs:
                 try:
                     rp = Path(tb).resolve(strict=True)
                 except OSError:
@@ -204,6 +312,653 @@ class Index:
         logger_method("{}: {}", ec.message, exception)
         return ec
 
+    def _attach_dataset(self, path):
+        """Attach to the tracking Dataset for the given tar ball, advancing it
+        to the INDEXING state.
+
+        Returns a tuple of the Dataset object (None if it could not be
+        attached) and its owner's user name (None if unknown).
+        """
+        idxctx = self.idxctx
+        try:
+            dataset = Dataset.attach(path=path, state=States.INDEXING,)
+        except DatasetNotFound:
+            idxctx.logger.warn(
+                "Unable to locate Dataset {}", path,
+            )
+        except DatasetTransitionError as e:
+            # TODO: This means the Dataset is known, but not in a
+            # state where we'd expect to be indexing it. So what do
+            # we do with it? (Note: this is where an audit log will
+            # be handy; i.e., how did we get here?) For now, just
+            # let it go.
+            idxctx.logger.warn("Unable to advance dataset state: {}", str(e))
+        else:
+            return dataset, dataset.owner
+        return None, None
+
+    def _advance_dataset(self, dataset, tb_res):
+        """Record the final indexing state of the given Dataset, if any."""
+        if not dataset or tb_res is None:
+            return
+        try:
+            dataset.advance(States.INDEXED if tb_res.success else States.QUARANTINED)
+            Metadata.remove(dataset, Metadata.REINDEX)
+        except DatasetTransitionError:
+            self.idxctx.logger.exception("Dataset state error")
+
+    def _index_tb(
+        self,
+        idxctx,
+        path,
+        controller,
+        username,
+        tmpdir,
+        ie_filepath,
+        sigint=True,
+        dataset=None,
+        stats=None,
+    ):
+        """Open the given tar ball and bulk index all the documents it
+        generates, recording any indexing errors which can't or won't be
+        retried in the file named by "ie_filepath".
+
+        When "sigint" is True, a SIGINT received while indexing raises
+        SigIntException so the caller can move on to the next tar ball.
+
+        When checkpoints are enabled, and given the tar ball's Dataset, the
+        units of documents already indexed by an earlier, interrupted attempt
+        are skipped.
+
+        Given an IndexingStats object, the time spent in each phase of
+        indexing the tar ball is added to it.
+
+        When the "single_pass" option is set, all the documents of the tar
+        ball are indexed at once, tool data included, by all but the
+        "--tool-data" pass.
+
+        When an "indexed_ids_dir" is configured, the documents already
+        indexed for the tar ball are not sent again, and those newly indexed
+        are recorded there (see IndexedIds).
+
+        Returns the tuple reported by es_index().
+        """
+        # "Open" the tar ball represented by the tar ball object
+        idxctx.logger.debug("open tar ball")
+        if stats is not None:
+            stats.tarballs += 1
+            wall = time.perf_counter()
+            cpu = time.process_time()
+        ptb = PbenchTarBall(
+            idxctx, username, path, tmpdir, Path(self.incoming, controller), stats,
+        )
+        if stats is not None:
+            stats.add("open", time.perf_counter() - wall, time.process_time() - cpu)
+
+        # Construct the generator for emitting all actions.  The
+        # `idxctx` dictionary is passed along to each generator so
+        # that it can add its context for error handling to the
+        # list.
+        idxctx.logger.debug("generator setup")
+        single_pass = idxctx.single_pass and not self.options.index_tool_data
+        if self.options.index_tool_data:
+            actions = ptb.mk_tool_data_actions()
+        elif single_pass:
+            actions = ptb.mk_single_pass_actions()
+        else:
+            actions = ptb.make_all_actions()
+
+        checkpoint = None
+        if dataset is not None and idxctx.checkpoint_actions > 0:
+            if self.options.index_tool_data:
+                checkpoint_key = Metadata.TOOL_INDEX_CHECKPOINT
+            else:
+                checkpoint_key = Metadata.INDEX_CHECKPOINT
+            checkpoint = ptb.mk_checkpoint(
+                self.options.index_tool_data,
+                self._get_checkpoint(dataset, checkpoint_key),
+                single_pass=single_pass,
+            )
+            if checkpoint.done:
+                idxctx.logger.info(
+                    "resuming indexing, {:d} units already indexed",
+                    len(checkpoint.done),
+                )
+
+        indexed_ids = None
+        if idxctx.indexed_ids_dir is not None:
+            indexed_ids = IndexedIds(
+                Path(idxctx.indexed_ids_dir, ptb.controller_dir, f"{ptb.dirname}.ids"),
+                idxctx.es,
+                idxctx.logger,
+            )
+            actions = indexed_ids.filter(actions)
+
+        def _es_index(fp, actions):
+            es_index_f = functools.partial(
+                es_index,
+                idxctx.es,
+                errorsfp=fp,
+                logger=idxctx.logger,
+                _dbg=idxctx._dbg,
+                bulk_requests=idxctx.bulk_requests,
+                bulk_target_latency=idxctx.bulk_target_latency,
+                bulk_request_timeout=idxctx.bulk_request_timeout,
+            )
+            if stats is None:
+                es_res = es_index_f(actions)
+            else:
+                es_res = stats.indexed(es_index_f, actions)
+            if indexed_ids is not None:
+                indexed_ids.indexed(es_res[4])
+            return es_res
+
+        def _index(fp):
+            if checkpoint is None:
+                return _es_index(fp, actions)
+            return self._es_index_checkpointed(
+                idxctx,
+                actions,
+                functools.partial(_es_index, fp),
+                dataset,
+                checkpoint_key,
+                checkpoint,
+            )
+
+        # File name for containing all indexing errors that
+        # can't/won't be retried.
+        with ie_filepath.open(mode="w") as fp:
+            idxctx.logger.debug("begin indexing")
+            if not sigint:
+                es_res = _index(fp)
+            else:
+                try:
+                    signal.signal(signal.SIGINT, sigint_handler)
+                    es_res = _index(fp)
+                finally:
+                    # Turn off the SIGINT handler when not indexing.
+                    signal.signal(signal.SIGINT, signal.SIG_IGN)
+        if indexed_ids is not None:
+            if indexed_ids.skipped:
+                idxctx.logger.info(
+                    "skipped {:d} documents already indexed", indexed_ids.skipped
+                )
+            indexed_ids.save()
+        return es_res
+
+    def _es_index_checkpointed(
+        self, idxctx, actions, es_index_f, dataset, key, checkpoint
+    ):
+        """Index the given actions using es_index_f(), "checkpoint_actions" at
+        a time, recording the units of documents done in the given checkpoint
+        metadata of the Dataset after each, and removing it once all the
+        actions are indexed without failures.
+
+        Returns the es_index() tuple for all the actions.
+        """
+        actions = iter(actions)
+        exhausted = False
+
+        def segment():
+            nonlocal exhausted
+            count = 0
+            for action in islice(actions, idxctx.checkpoint_actions):
+                count += 1
+                yield action
+            exhausted = count < idxctx.checkpoint_actions
+
+        beg = None
+        counts = (0, 0, 0, 0)
+        while not exhausted:
+            es_res = es_index_f(segment())
+            if beg is None:
+                beg = es_res[0]
+            end = es_res[1]
+            counts = tuple(c + r for c, r in zip(counts, es_res[2:]))
+            if checkpoint.acknowledged(es_res[4]):
+                self._set_checkpoint(
+                    dataset, key, checkpoint.encode(_CHECKPOINT_MAX_LEN)
+                )
+        if counts[2] == 0:
+            self._set_checkpoint(dataset, key, None)
+        return (beg, end, *counts)
+
+    def _get_checkpoint(self, dataset, key):
+        """Return the encoded checkpoint recorded for the Dataset, if any."""
+        try:
+            return Metadata.get(dataset, key).value
+        except MetadataNotFound:
+            return None
+        except MetadataError as e:
+            self.idxctx.logger.warning("Unable to get {}: {}", key, e)
+            return None
+
+    def _set_checkpoint(self, dataset, key, value):
+        """Record the encoded checkpoint for the Dataset, removing it when the
+        value is None.  Failing to do so is not fatal, as it only means more
+        documents are indexed again should indexing be interrupted.
+        """
+        try:
+            if value is None:
+                Metadata.remove(dataset, key)
+                return
+            try:
+                meta = Metadata.get(dataset, key)
+            except MetadataNotFound:
+                Metadata.create(dataset=dataset, key=key, value=value)
+            else:
+                meta.value = value
+                meta.update()
+        except MetadataError as e:
+            self.idxctx.logger.warning("Unable to record {}: {}", key, e)
+
+    def _tb_error(self, idxctx, exc):
+        """Log and return the error code for an exception raised while
+        indexing a tar ball.
+
+        This must be called from the exception handler for "exc" so that
+        unexpected errors are logged with their traceback.
+        """
+        if isinstance(exc, UnsupportedTarballFormat):
+            return self.emit_error(idxctx.logger.warning, "TB_META_ABSENT", exc)
+        elif isinstance(exc, BadDate):
+            return self.emit_error(idxctx.logger.warning, "BAD_DATE", exc)
+        elif isinstance(exc, FileNotFoundError):
+            return self.emit_error(idxctx.logger.warning, "FILE_NOT_FOUND_ERROR", exc)
+        elif isinstance(exc, BadMDLogFormat):
+            return self.emit_error(idxctx.logger.warning, "BAD_METADATA", exc)
+        else:
+            return self.emit_error(idxctx.logger.exception, "GENERIC_ERROR", exc)
+
+    def _tb_indexed(self, idxctx, es_res):
+        """Log the outcome of indexing a tar ball, returning its error code."""
+        beg, end, successes, duplicates, failures, retries = es_res
+        idxctx.logger.info(
+            "done indexing (start ts: {}, end ts: {}, duration:"
+            " {:.2f}s, successes: {:d}, duplicates: {:d},"
+            " failures: {:d}, retries: {:d})",
+            tstos(beg),
+            tstos(end),
+            end - beg,
+            successes,
+            duplicates,
+            failures,
+            retries,
+        )
+        return self.error_code["OP_ERROR" if failures > 0 else "OK"]
+
+    def _tb_done(
+        self,
+        report,
+        tb,
+        size,
+        tb_res,
+        end,
+        ie_filepath,
+        indexed,
+        erred,
+        skipped,
+        sigquit,
+    ):
+        """Finish the processing of a tar ball: post any indexing errors,
+        record the tar ball in the proper report file, and move its symlink
+        to the directory reflecting the result.
+        """
+        idxctx = self.idxctx
+        error_code = self.error_code
+        try:
+            ie_len = ie_filepath.stat().st_size
+        except FileNotFoundError:
+            # Above operation never made it to actual indexing, ignore.
+            pass
+        except SigTermException:
+            # Re-raise a SIGTERM to avoid it being lumped in with
+            # general exception handling below.
+            raise
+        except Exception:
+            idxctx.logger.exception(
+                "Unexpected error handling" " indexing errors file: {}", ie_filepath,
+            )
+        else:
+            # Success fetching indexing error file size.
+            if ie_len > len(tb) + 1:
+                try:
+                    report.post_status(tstos(end), "errors", ie_filepath)
+                except Exception:
+                    idxctx.logger.exception(
+                        "Unexpected error issuing" " report status with errors: {}",
+                        ie_filepath,
+                    )
+        finally:
+            # Unconditionally remove the indexing errors file.
+            try:
+                os.remove(ie_filepath)
+            except SigTermException:
+                # Re-raise a SIGTERM to avoid it being lumped in with
+                # general exception handling below.
+                raise
+            except Exception:
+                pass
+        # Distinguish failure cases, so we can retry the indexing
+        # easily if possible.  Different `linkerrdest` directories for
+        # different failures; the rest are going to end up in
+        # `linkerrdest` for later retry.
+        controller_path = Path(tb).parent.parent
+
+        if tb_res is error_code["OK"]:
+            idxctx.logger.info(
+                "{}: {}/{}: success",
+                idxctx.TS,
+                controller_path.name,
+                os.path.basename(tb),
+            )
+            # Success
+            with indexed.open(mode="a") as fp:
+                print(tb, file=fp)
+            rename_tb_link(tb, Path(controller_path, self.linkdest), idxctx.logger)
+        elif tb_res is error_code["OP_ERROR"]:
+            idxctx.logger.warning(
+                "{}: index failures encountered on {}", idxctx.TS, tb
+            )
+            with erred.open(mode="a") as fp:
+                print(tb, file=fp)
+            rename_tb_link(
+                tb, Path(controller_path, f"{self.linkerrdest}.1"), idxctx.logger,
+            )
+        elif tb_res in (error_code["CFG_ERROR"], error_code["BAD_CFG"]):
+            assert False, (
+                f"Logic Bomb!  Unexpected tar ball handling "
+                f"result status {tb_res.value:d} for tar ball {tb}"
+            )
+        elif tb_res.tarball_error:
+            # # Quietly skip these errors
+            with skipped.open(mode="a") as fp:
+                print(tb, file=fp)
+            rename_tb_link(
+                tb,
+                Path(controller_path, f"{self.linkerrdest}.{tb_res.value:d}",),
+                idxctx.logger,
+            )
+        else:
+            idxctx.logger.error(
+                "{}: index error {:d} encountered on {}",
+                idxctx.TS,
+                tb_res.value,
+                tb,
+            )
+            with erred.open(mode="a") as fp:
+                print(tb, file=fp)
+            rename_tb_link(
+                tb, Path(controller_path, self.linkerrdest), idxctx.logger,
+            )
+        idxctx.logger.info(
+            "Finished{} {} (size {:d})", "[SIGQUIT]" if sigquit else "", tb, size,
+        )
+
+    def _post_stats(self, report, run_stats, stats=None, tb=None, queue_wait=None):
+        """Post the indexing statistics of the given tar ball, adding them to
+        those of the whole run, or, without a tar ball, those of the whole
+        run, as an "indexing-stats" server report.
+
+        The time (seconds) the tar ball waited to be indexed is included
+        when known.
+        """
+        if run_stats is None:
+            return
+        if tb is None:
+            indexing = dict(scope="run")
+            stats = run_stats
+        elif stats is None:
+            # The tar ball never made it to indexing.
+            return
+        else:
+            run_stats.merge(stats)
+            indexing = dict(
+                scope="tarball",
+                controller=Path(tb).parent.parent.name,
+                tarball=Path(tb).name,
+            )
+            if queue_wait is not None:
+                indexing["queue_wait_secs"] = queue_wait
+        indexing.update(stats.as_dict())
+        try:
+            report.post_status(
+                tstos(self.idxctx.time()),
+                "indexing-stats",
+                payload=dict(indexing=indexing),
+            )
+        except SigTermException:
+            # Re-raise a SIGTERM to avoid it being lumped in with general
+            # exception handling below.
+            raise
+        except Exception:
+            self.idxctx.logger.warning(
+                "Unable to post the indexing statistics of {}", tb or "the run"
+            )
+
+    def _sighup_recollect(
+        self, tb_queue, tb, count_processed_tb, erred, tb_res, in_flight=()
+    ):
+        """Re-evaluate the list of tar balls to index on receipt of a SIGHUP,
+        ignoring those in flight, and reset the queue of tar balls to
+        process with it.
+        """
+        idxctx = self.idxctx
+        status, new_tb = self.collect_tb()
+        if status == 0:
+            if not set(new_tb).issuperset(tb_queue):
+                idxctx.logger.info(
+                    "Tarballs supposed to be in 'TO-INDEX' are no longer present",
+                    set(tb_queue).difference(new_tb),
+                )
+            tb_queue.reset(t for t in new_tb if t[2] not in in_flight)
+        idxctx.logger.info(
+            "SIGHUP status (Current tar ball indexed: ({}), Remaining: {}, Completed: {}, Errors_encountered: {}, Status: {})",
+            Path(tb).name,
+            len(tb_queue),
+            count_processed_tb,
+            _count_lines(erred),
+            tb_res,
+        )
+
+    def _queue_wait(self, tb_queue, tb):
+        """Return the time (seconds) the given tar ball waited to be indexed,
+        logging it when scheduling fairly, or None if not recorded.
+        """
+        queue_wait = tb_queue.queue_wait(tb)
+        if queue_wait is not None and tb_queue.fair:
+            self.idxctx.logger.info("{} waited {:.0f}s to be indexed", tb, queue_wait)
+        return queue_wait
+
+    def _check_linksrc(self, tb):
+        """Sanity check source tar ball path"""
+        assert Path(tb).parent.name == self.linksrc, (
+            f"Logic bomb!  tar ball " f"path {tb} does not contain {self.linksrc}"
+        )
+
+    def _process_tb_serial(
+        self,
+        tb_queue,
+        report,
+        tmpdir,
+        indexed,
+        erred,
+        skipped,
+        sigquit_interrupt,
+        sighup_interrupt,
+        run_stats,
+    ):
+        """Index the tar balls one at a time, in the order of the queue."""
+        idxctx = self.idxctx
+        ie_filepath = Path(tmpdir, f"{self.name}.{idxctx.TS}.indexing-errors.json")
+        count_processed_tb = 0
+        tb_res = None
+
+        while True:
+            item = tb_queue.next_tarball()
+            if item is None:
+                break
+            size, controller, tb = item
+            count_processed_tb += 1
+            self._check_linksrc(tb)
+
+            idxctx.logger.info("Starting {} (size {:d})", tb, size)
+            queue_wait = self._queue_wait(tb_queue, tb)
+            dataset = None
+            end = None
+            stats = IndexingStats() if run_stats is not None else None
+            try:
+                path = os.path.realpath(tb)
+                dataset, username = self._attach_dataset(path)
+                es_res = self._index_tb(
+                    idxctx,
+                    path,
+                    controller,
+                    username,
+                    tmpdir,
+                    ie_filepath,
+                    dataset=dataset,
+                    stats=stats,
+                )
+            except SigIntException:
+                idxctx.logger.exception(
+                    "Indexing interrupted by SIGINT, continuing to next tarball"
+                )
+                continue
+            except SigTermException:
+                idxctx.logger.exception("Indexing interrupted by SIGTERM, terminating")
+                break
+            except Exception as e:
+                tb_res = self._tb_error(idxctx, e)
+            else:
+                end = es_res[1]
+                tb_res = self._tb_indexed(idxctx, es_res)
+            finally:
+                self._advance_dataset(dataset, tb_res)
+
+            self._tb_done(
+                report,
+                tb,
+                size,
+                tb_res,
+                end,
+                ie_filepath,
+                indexed,
+                erred,
+                skipped,
+                sigquit_interrupt[0],
+            )
+            self._post_stats(report, run_stats, stats, tb, queue_wait)
+
+            if sigquit_interrupt[0]:
+                break
+            if sighup_interrupt[0]:
+                self._sighup_recollect(tb_queue, tb, count_processed_tb, erred, tb_res)
+                sighup_interrupt[0] = False
+
+    def _process_tb_pool(
+        self,
+        tb_queue,
+        report,
+        tmpdir,
+        indexed,
+        erred,
+        skipped,
+        sigquit_interrupt,
+        sighup_interrupt,
+        run_stats,
+    ):
+        """Index up to "idxctx.workers" tar balls concurrently using a pool of
+        worker processes.
+
+        Only the generation and bulk indexing of the documents for each tar
+        ball is performed by the workers.  This process retains ownership of
+        the Dataset state transitions, the indexing errors reports, the
+        indexed / erred / skipped report files, and the tar ball symlinks, so
+        each tar ball is finished exactly as it would be serially.
+
+        The signal semantics are preserved as follows: on SIGQUIT no new tar
+        balls are started, but those in flight are allowed to finish; on
+        SIGHUP the list of tar balls is re-evaluated once an in-flight tar
+        ball finishes; on SIGTERM the workers are terminated immediately.
+
+        The queue decides which tar balls may start given the sizes of those
+        in flight (see IndexingQueue).
+        """
+        global _pool_index
+        idxctx = self.idxctx
+        count_processed_tb = 0
+        results = queue.Queue()
+        in_flight = {}
+
+        # The workers are forked from this process, and find the Index object
+        # via this module global.
+        _pool_index = self
+        pool = multiprocessing.Pool(processes=idxctx.workers, initializer=_pool_init)
+        idxctx.logger.debug("started pool of {:d} indexing workers", idxctx.workers)
+        try:
+            while tb_queue or in_flight:
+                while len(in_flight) < idxctx.workers and not sigquit_interrupt[0]:
+                    item = tb_queue.next_tarball(t[0] for t in in_flight.values())
+                    if item is None:
+                        break
+                    size, controller, tb = item
+                    self._check_linksrc(tb)
+                    idxctx.logger.info("Starting {} (size {:d})", tb, size)
+                    queue_wait = self._queue_wait(tb_queue, tb)
+                    path = os.path.realpath(tb)
+                    dataset, username = self._attach_dataset(path)
+                    ie_filepath = Path(
+                        tmpdir,
+                        f"{self.name}.{idxctx.TS}.{Path(tb).name}.indexing-errors.json",
+                    )
+                    in_flight[tb] = (size, dataset, ie_filepath, queue_wait)
+                    pool.apply_async(
+                        _pool_index_tb,
+                        (path, controller, username, tmpdir, str(ie_filepath)),
+                        callback=functools.partial(_pool_done, results, tb),
+                        error_callback=functools.partial(_pool_failed, results, tb),
+                    )
+                if not in_flight:
+                    # SIGQUIT received, or no more tar balls may be started,
+                    # with tar balls remaining.
+                    break
+                try:
+                    tb, tb_res_name, es_res, stats = results.get(timeout=1)
+                except queue.Empty:
+                    continue
+                size, dataset, ie_filepath, queue_wait = in_flight.pop(tb)
+                count_processed_tb += 1
+                tb_res = self.error_code[tb_res_name]
+                self._advance_dataset(dataset, tb_res)
+                self._tb_done(
+                    report,
+                    tb,
+                    size,
+                    tb_res,
+                    es_res[1] if es_res else None,
+                    ie_filepath,
+                    indexed,
+                    erred,
+                    skipped,
+                    sigquit_interrupt[0],
+                )
+                self._post_stats(report, run_stats, stats, tb, queue_wait)
+                if sighup_interrupt[0]:
+                    # Don't pick up the tar balls still being indexed.
+                    self._sighup_recollect(
+                        tb_queue, tb, count_processed_tb, erred, tb_res, in_flight
+                    )
+                    sighup_interrupt[0] = False
+        except SigTermException:
+            pool.terminate()
+            raise
+        else:
+            pool.close()
+        finally:
+            pool.join()
+            _pool_index = None
+
     def process_tb(self, tarballs):
         """Process Tarballs For Indexing and creates report
 
@@ -213,11 +968,20 @@ class Index:
         idxctx = self.idxctx
         error_code = self.error_code
 
-        tb_deque = deque(sorted(tarballs))
-
         # At this point, tarballs contains a list of tar balls sorted by size
-        # that were available as symlinks in the various 'linksrc' directories.
-        idxctx.logger.debug("Preparing to index {:d} tar balls", len(tb_deque))
+        # that were available as symlinks in the various 'linksrc' directories,
+        # which we queue up for indexing.  The time budget starts now.
+        tb_queue = IndexingQueue(
+            tarballs,
+            fair=idxctx.fair_scheduling,
+            fast_lane_size=idxctx.fast_lane_size,
+            fast_lane_bytes=idxctx.fast_lane_bytes,
+            slow_lane_bytes=idxctx.slow_lane_bytes,
+            time_budget=idxctx.time_budget,
+            workers=idxctx.workers,
+            record_waits=idxctx.fair_scheduling or idxctx.phase_stats,
+        )
+        idxctx.logger.debug("Preparing to index {:d} tar balls", len(tb_queue))
 
         try:
             # Now that we are ready to begin the actual indexing step, ensure we
@@ -283,9 +1047,6 @@ class Index:
                 indexed = Path(tmpdir, f"{self.name}.{idxctx.TS}.indexed")
                 erred = Path(tmpdir, f"{self.name}.{idxctx.TS}.erred")
                 skipped = Path(tmpdir, f"{self.name}.{idxctx.TS}.skipped")
-                ie_filepath = Path(
-                    tmpdir, f"{self.name}.{idxctx.TS}.indexing-errors.json"
-                )
 
                 # We use a list object here so that when we close over this
                 # variable in the handler, the list object will be closed over,
@@ -302,266 +1063,24 @@ class Index:
 
                 signal.signal(signal.SIGQUIT, sigquit_handler)
                 signal.signal(signal.SIGHUP, sighup_handler)
-                count_processed_tb = 0
+                if idxctx.workers > 1:
+                    process = self._process_tb_pool
+                else:
+                    process = self._process_tb_serial
+                run_stats = IndexingStats() if idxctx.phase_stats else None
 
                 try:
-                    while len(tb_deque) > 0:
-                        size, controller, tb = tb_deque.popleft()
-                        # Sanity check source tar ball path
-                        linksrc_dir = Path(tb).parent
-                        linksrc_dirname = linksrc_dir.name
-                        count_processed_tb += 1
-                        assert linksrc_dirname == self.linksrc, (
-                            f"Logic bomb!  tar ball "
-                            f"path {tb} does not contain {self.linksrc}"
-                        )
-
-                        idxctx.logger.info("Starting {} (size {:d})", tb, size)
-                        dataset = None
-                        ptb = None
-                        username = None
-                        try:
-                            path = os.path.realpath(tb)
-
-                            try:
-                                dataset = Dataset.attach(
-                                    path=path, state=States.INDEXING,
-                                )
-                            except DatasetNotFound:
-                                idxctx.logger.warn(
-                                    "Unable to locate Dataset {}", path,
-                                )
-                            except DatasetTransitionError as e:
-                                # TODO: This means the Dataset is known, but not in a
-                                # state where we'd expect to be indexing it. So what do
-                                # we do with it? (Note: this is where an audit log will
-                                # be handy; i.e., how did we get here?) For now, just
-                                # let it go.
-                                idxctx.logger.warn(
-                                    "Unable to advance dataset state: {}", str(e)
-                                )
-                            else:
-                                username = dataset.owner
-
-                            # "Open" the tar ball represented by the tar ball object
-                            idxctx.logger.debug("open tar ball")
-                            ptb = PbenchTarBall(
-                                idxctx,
-                                username,
-                                path,
-                                tmpdir,
-                                Path(self.incoming, controller),
-                            )
-
-                            # Construct the generator for emitting all actions.  The
-                            # `idxctx` dictionary is passed along to each generator so
-                            # that it can add its context for error handling to the
-                            # list.
-                            idxctx.logger.debug("generator setup")
-                            if self.options.index_tool_data:
-                                actions = ptb.mk_tool_data_actions()
-                            else:
-                                actions = ptb.make_all_actions()
-
-                            # File name for containing all indexing errors that
-                            # can't/won't be retried.
-                            with ie_filepath.open(mode="w") as fp:
-                                idxctx.logger.debug("begin indexing")
-                                try:
-                                    signal.signal(signal.SIGINT, sigint_handler)
-                                    es_res = es_index(
-                                        idxctx.es,
-                                        actions,
-                                        fp,
-                                        idxctx.logger,
-                                        idxctx._dbg,
-                                    )
-                                except SigIntException:
-                                    idxctx.logger.exception(
-                                        "Indexing interrupted by SIGINT, continuing to next tarball"
-                                    )
-                                    continue
-                                finally:
-                                    # Turn off the SIGINT handler when not indexing.
-                                    signal.signal(signal.SIGINT, signal.SIG_IGN)
-                        except UnsupportedTarballFormat as e:
-                            tb_res = self.emit_error(
-                                idxctx.logger.warning, "TB_META_ABSENT", e
-                            )
-                        except BadDate as e:
-                            tb_res = self.emit_error(
-                                idxctx.logger.warning, "BAD_DATE", e
-                            )
-                        except FileNotFoundError as e:
-                            tb_res = self.emit_error(
-                                idxctx.logger.warning, "FILE_NOT_FOUND_ERROR", e
-                            )
-                        except BadMDLogFormat as e:
-                            tb_res = self.emit_error(
-                                idxctx.logger.warning, "BAD_METADATA", e
-                            )
-                        except SigTermException:
-                            idxctx.logger.exception(
-                                "Indexing interrupted by SIGTERM, terminating"
-                            )
-                            break
-                        except Exception as e:
-                            tb_res = self.emit_error(
-                                idxctx.logger.exception, "GENERIC_ERROR", e
-                            )
-                        else:
-                            beg, end, successes, duplicates, failures, retries = es_res
-                            idxctx.logger.info(
-                                "done indexing (start ts: {}, end ts: {}, duration:"
-                                " {:.2f}s, successes: {:d}, duplicates: {:d},"
-                                " failures: {:d}, retries: {:d})",
-                                tstos(beg),
-                                tstos(end),
-                                end - beg,
-                                successes,
-                                duplicates,
-                                failures,
-                                retries,
-                            )
-                            tb_res = error_code["OP_ERROR" if failures > 0 else "OK"]
-                        finally:
-                            if dataset:
-                                try:
-                                    dataset.advance(
-                                        States.INDEXED
-                                        if tb_res.success
-                                        else States.QUARANTINED
-                                    )
-                                    Metadata.remove(dataset, Metadata.REINDEX)
-                                except DatasetTransitionError:
-                                    idxctx.logger.exception("Dataset state error")
-
-                        try:
-                            ie_len = ie_filepath.stat().st_size
-                        except FileNotFoundError:
-                            # Above operation never made it to actual indexing, ignore.
-                            pass
-                        except SigTermException:
-                            # Re-raise a SIGTERM to avoid it being lumped in with
-                            # general exception handling below.
-                            raise
-                        except Exception:
-                            idxctx.logger.exception(
-                                "Unexpected error handling" " indexing errors file: {}",
-                                ie_filepath,
-                            )
-                        else:
-                            # Success fetching indexing error file size.
-                            if ie_len > len(tb) + 1:
-                                try:
-                                    report.post_status(
-                                        tstos(end), "errors", ie_filepath
-                                    )
-                                except Exception:
-                                    idxctx.logger.exception(
-                                        "Unexpected error issuing"
-                                        " report status with errors: {}",
-                                        ie_filepath,
-                                    )
-                        finally:
-                            # Unconditionally remove the indexing errors file.
-                            try:
-                                os.remove(ie_filepath)
-                            except SigTermException:
-                                # Re-raise a SIGTERM to avoid it being lumped in with
-                                # general exception handling below.
-                                raise
-                            except Exception:
-                                pass
-                        # Distinguish failure cases, so we can retry the indexing
-                        # easily if possible.  Different `linkerrdest` directories for
-                        # different failures; the rest are going to end up in
-                        # `linkerrdest` for later retry.
-                        controller_path = linksrc_dir.parent
-
-                        if tb_res is error_code["OK"]:
-                            idxctx.logger.info(
-                                "{}: {}/{}: success",
-                                idxctx.TS,
-                                controller_path.name,
-                                os.path.basename(tb),
-                            )
-                            # Success
-                            with indexed.open(mode="a") as fp:
-                                print(tb, file=fp)
-                            rename_tb_link(
-                                tb, Path(controller_path, self.linkdest), idxctx.logger
-                            )
-                        elif tb_res is error_code["OP_ERROR"]:
-                            idxctx.logger.warning(
-                                "{}: index failures encountered on {}", idxctx.TS, tb
-                            )
-                            with erred.open(mode="a") as fp:
-                                print(tb, file=fp)
-                            rename_tb_link(
-                                tb,
-                                Path(controller_path, f"{self.linkerrdest}.1"),
-                                idxctx.logger,
-                            )
-                        elif tb_res in (error_code["CFG_ERROR"], error_code["BAD_CFG"]):
-                            assert False, (
-                                f"Logic Bomb!  Unexpected tar ball handling "
-                                f"result status {tb_res.value:d} for tar ball {tb}"
-                            )
-                        elif tb_res.tarball_error:
-                            # # Quietly skip these errors
-                            with skipped.open(mode="a") as fp:
-                                print(tb, file=fp)
-                            rename_tb_link(
-                                tb,
-                                Path(
-                                    controller_path,
-                                    f"{self.linkerrdest}.{tb_res.value:d}",
-                                ),
-                                idxctx.logger,
-                            )
-                        else:
-                            idxctx.logger.error(
-                                "{}: index error {:d} encountered on {}",
-                                idxctx.TS,
-                                tb_res.value,
-                                tb,
-                            )
-                            with erred.open(mode="a") as fp:
-                                print(tb, file=fp)
-                            rename_tb_link(
-                                tb,
-                                Path(controller_path, self.linkerrdest),
-                                idxctx.logger,
-                            )
-                        idxctx.logger.info(
-                            "Finished{} {} (size {:d})",
-                            "[SIGQUIT]" if sigquit_interrupt[0] else "",
-                            tb,
-                            size,
-                        )
-
-                        if sigquit_interrupt[0]:
-                            break
-                        if sighup_interrupt[0]:
-                            status, new_tb = self.collect_tb()
-                            if status == 0:
-                                if not set(new_tb).issuperset(tb_deque):
-                                    idxctx.logger.info(
-                                        "Tarballs supposed to be in 'TO-INDEX' are no longer present",
-                                        set(tb_deque).difference(new_tb),
-                                    )
-                                tb_deque = deque(sorted(new_tb))
-                            idxctx.logger.info(
-                                "SIGHUP status (Current tar ball indexed: ({}), Remaining: {}, Completed: {}, Errors_encountered: {}, Status: {})",
-                                Path(tb).name,
-                                len(tb_deque),
-                                count_processed_tb,
-                                _count_lines(erred),
-                                tb_res,
-                            )
-                            sighup_interrupt[0] = False
-                            continue
+                    process(
+                        tb_queue,
+                        report,
+                        tmpdir,
+                        indexed,
+                        erred,
+                        skipped,
+                        sigquit_interrupt,
+                        sighup_interrupt,
+                        run_stats,
+                    )
                 except SigTermException:
                     idxctx.logger.exception(
                         "Indexing interrupted by SIGQUIT, stop processing tarballs"
@@ -570,6 +1089,14 @@ class Index:
                     # Turn off the SIGQUIT and SIGHUP handler when not indexing.
                     signal.signal(signal.SIGQUIT, signal.SIG_IGN)
                     signal.signal(signal.SIGHUP, signal.SIG_IGN)
+                reason = tb_queue.deferral_reason()
+                if reason is not None:
+                    idxctx.logger.info(
+                        "Leaving {:d} tar balls for the next run, {}",
+                        len(tb_queue),
+                        reason,
+                    )
+                self._post_stats(report, run_stats)
             except SigTermException:
                 # Re-raise a SIGTERM to avoid it being lumped in with general
                 # exception handling below.
@@ -0,0 +1,180 @@
+"""Tar ball member manifests.
+
+A manifest records the name, type, size, mode, modification time, and link
+target of every member of a pbench result tar ball.  It is written once, when
+the tar ball is unpacked, from the same decompressed stream being unpacked,
+next to the tar ball in the archive (and not in the unpacked tar ball, which
+is published as is), so that the indexer can list the members of the tar ball
+without having to decompress it again on every indexing pass.
+
+The manifest is a file of JSON lines: a header recording the manifest format
+version, the tar ball name and its MD5 sum, followed by one JSON array per
+member, in the order they appear in the tar ball.
+"""
+
+import json
+import os
+import tarfile
+
+
+# Suffix added to the path of a tar ball to form the path of its manifest.
+MANIFEST_SUFFIX = ".manifest"
+
+MANIFEST_VERSION = 1
+
+
+def manifest_path(tb_path):
+    """Return the path of the manifest of the given tar ball."""
+    return f"{tb_path}{MANIFEST_SUFFIX}"
+
+
+class ManifestError(Exception):
+    pass
+
+
+class ManifestMember:
+    """A tar ball member as recorded in a manifest, offering the subset of the
+    tarfile.TarInfo interface used by the indexer.
+    """
+
+    __slots__ = ("name", "type", "size", "mode", "mtime", "linkpath")
+
+    def __init__(self, name, type, size, mode, mtime, linkpath):
+        self.name = name
+        self.type = type
+        self.size = size
+        self.mode = mode
+        self.mtime = mtime
+        self.linkpath = linkpath
+
+    @classmethod
+    def from_tarinfo(cls, m):
+        return cls(m.name, m.type, m.size, m.mode, m.mtime, m.linkname)
+
+    def isfile(self):
+        return self.type in tarfile.REGULAR_TYPES
+
+    def isdir(self):
+        return self.type == tarfile.DIRTYPE
+
+    def issym(self):
+        return self.type == tarfile.SYMTYPE
+
+
+class TeeReader:
+    """A file object reading from the given source file object, copying all
+    the data read to the given destination file object.
+    """
+
+    def __init__(self, src, dst):
+        self.src = src
+        self.dst = dst
+
+    def read(self, size=-1):
+        data = self.src.read(size)
+        self.dst.write(data)
+        return data
+
+    def drain(self, bufsize=1024 * 1024):
+        """Copy the rest of the source to the destination."""
+        while self.read(bufsize):
+            pass
+
+
+def _members(tb):
+    """Yield the members of the given tar ball, open for reading, without the
+    TarFile object keeping them all as it goes.
+    """
+    while True:
+        m = tb.next()
+        if m is None:
+            return
+        tb.members.clear()
+        yield m
+
+
+def _open(tb_path):
+    """Open the given, possibly compressed, tar ball to read its members in
+    order, once.
+
+    It is not opened as a stream ("r|*"), since tarfile's own decompression
+    of streams re-copies the whole decompressed buffer for every header
+    read, which for tar balls of many small files is several times slower.
+    """
+    return tarfile.open(tb_path, mode="r:*")
+
+
+def write_manifest(tb_path, md5sum, manifest_path, fileobj=None):
+    """Write the manifest of the given tar ball, with the given MD5 sum, to
+    the given path.
+
+    The tar ball is read in a single pass, as a stream from the given file
+    object of its decompressed contents if any, or from the tar ball itself
+    otherwise.  The manifest is written to a temporary file which is renamed
+    into place once complete, so that a partial manifest is never seen.
+    """
+    tmp_path = f"{manifest_path}.tmp"
+    if fileobj is None:
+        tb = _open(tb_path)
+    else:
+        tb = tarfile.open(mode="r|", fileobj=fileobj)
+    try:
+        with tb, open(tmp_path, "w") as fp:
+            header = dict(
+                version=MANIFEST_VERSION,
+                tarball=os.path.basename(tb_path),
+                md5=md5sum,
+            )
+            print(json.dumps(header), file=fp)
+            for m in _members(tb):
+                rec = [m.name, m.type.decode(), m.size, m.mode, m.mtime, m.linkname]
+                print(json.dumps(rec), file=fp)
+    except BaseException:
+        try:
+            os.unlink(tmp_path)
+        except OSError:
+            pass
+        raise
+    os.replace(tmp_path, manifest_path)
+
+
+def list_members(tb_path):
+    """List the members of the given tar ball, as ManifestMember objects,
+    reading it in a single pass.
+
+    Unlike tarfile.TarFile.getmembers(), this neither keeps the tar ball open
+    nor holds on to the much larger TarInfo objects.
+    """
+    with _open(tb_path) as tb:
+        return [ManifestMember.from_tarinfo(m) for m in _members(tb)]
+
+
+def load_manifest(manifest_path, tb_name, md5sum):
+    """Load the list of ManifestMember objects from the given manifest,
+    verifying that it was written for the tar ball with the given name and
+    MD5 sum.
+
+    Raises ManifestError if the manifest is not usable.
+    """
+    members = []
+    with open(manifest_path, "r") as fp:
+        try:
+            header = json.loads(fp.readline())
+        except ValueError as exc:
+            raise ManifestError(f"bad manifest header: {exc}")
+        if not isinstance(header, dict) or header.get("version") != MANIFEST_VERSION:
+            raise ManifestError(f"unsupported manifest header: {header!r}")
+        if header.get("tarball") != tb_name or header.get("md5") != md5sum:
+            raise ManifestError(
+                f"manifest is for tar ball {header.get('tarball')!r}"
+                f" ({header.get('md5')}), not {tb_name!r} ({md5sum})"
+            )
+        for line in fp:
+            try:
+                name, mtype, size, mode, mtime, linkpath = json.loads(line)
+            except (TypeError, ValueError) as exc:
+                raise ManifestError(f"bad manifest entry, {line!r}: {exc}")
+            members.append(
+                ManifestMember(name, mtype.encode(), size, mode, mtime, linkpath)
+            )
+    return members
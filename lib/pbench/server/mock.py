@@ -35,6 +35,30 @@ class MockElasticsearch:
         self.mockstrm = _MockObject(streaming_bulk=self.msb.streaming_bulk)
 
 
+class MockBulkSink:
+    """A sink for bulk indexing actions which just counts them by index, along
+    with the size of the bulk request bodies they make up, for measuring the
+    generation of actions without an Elasticsearch instance.
+    """
+
+    def __init__(self):
+        self.reset()
+
+    def reset(self):
+        self.docs = Counter()
+        self.bytes = Counter()
+
+    def index(self, action):
+        source = action["_source"]
+        if not isinstance(source, str):
+            source = json.dumps(source)
+        header = json.dumps(
+            {action["_op_type"]: {"_index": action["_index"], "_id": action["_id"]}}
+        )
+        self.docs[action["_index"]] += 1
+        self.bytes[action["_index"]] += len(header) + len(source) + 2
+
+
 class _MockObject:
     def __init__(self, **kwargs):
         self.__dict__.update(kwargs)
@@ -145,9 +145,10 @@ class Report:
         """
         yield self._make_json_payload(base_source)
 
-    def post_status(self, timestamp, doctype, file_to_index=None):
+    def post_status(self, timestamp, doctype, file_to_index=None, payload=None):
         """Post a status record, with an optional file payload to index along
-        with the base tracking document.
+        with the base tracking document, and an optional dictionary of fields
+        to add to the base tracking document (e.g. structured statistics).
 
         We return the tracking ID use for this report object.
         """
@@ -164,6 +165,8 @@ class Report:
                 "name": self.name,
                 "doctype": doctype,
             }
+            if payload:
+                base_source.update(payload)
             if file_to_index:
                 payload_gen = self._gen_json_payload(base_source, file_to_index)
             else:
@@ -1,5 +1,6 @@
 import copy
 import glob
+import hashlib
 import json
 import os
 import pyesbulk
@@ -56,7 +57,21 @@ class PbenchTemplates:
 
     _fpat = re.compile(r"tool-data-frag-(?P<toolname>.+)\.json")
 
-    def __init__(self, basepath, idx_prefix, logger, known_tool_handlers=None, _dbg=0):
+    # Name of the file in the cache directory holding the loaded templates, and
+    # the version of its format.
+    _cache_name = "pbench-templates.json"
+    _cache_format = 1
+
+    def __init__(
+        self,
+        basepath,
+        idx_prefix,
+        logger,
+        known_tool_handlers=None,
+        _dbg=0,
+        tool_data_rollups=False,
+        cache_dir=None,
+    ):
         # Where to find the mappings
         MAPPING_DIR = os.path.join(os.path.dirname(basepath), "lib", "mappings")
         # Where to find the settings
@@ -67,7 +82,18 @@ class PbenchTemplates:
         self.idx_prefix = idx_prefix
         self.logger = logger
         self.known_tool_handlers = known_tool_handlers
+        self.tool_data_rollups = tool_data_rollups
         self._dbg = _dbg
+        self.counters = Counter()
+
+        # When given a cache directory, the templates loaded by a previous
+        # invocation are reused as long as none of the mapping and settings
+        # files, nor the arguments shaping the templates, have changed.
+        cache_key = None
+        if cache_dir is not None:
+            cache_key = self._cache_key(MAPPING_DIR, SETTING_DIR)
+            if self._load_cache(cache_dir, cache_key):
+                return
 
         # Pbench report status mapping and settings.
         mfile = os.path.join(MAPPING_DIR, "server-reports.json")
@@ -191,6 +217,32 @@ class PbenchTemplates:
             )
             self.templates[tool_template_name] = tool_template_body
 
+        if tool_data_rollups:
+            # The tool data rollup documents share the tool data skeleton,
+            # and, unlike the tool data, their mapping is the same for all
+            # tools, though each tool has its own rollup index.
+            mfile = os.path.join(MAPPING_DIR, "tool-data-rollup.json")
+            key, idxver, rollup = self._fetch_mapping(mfile)
+            del rollup["_meta"]
+            ip = self.index_patterns[key]
+            for toolname in tool_mapping_frags:
+                rollup_mapping = copy.deepcopy(skel)
+                rollup_mapping["_meta"] = dict(version=idxver)
+                rollup_mapping["properties"].update(copy.deepcopy(rollup["properties"]))
+                idxname = ip["idxname"].format(tool=toolname)
+                rollup_template_name = ip["template_name"].format(
+                    prefix=self.idx_prefix, version=idxver, idxname=idxname
+                )
+                rollup_template_body = dict(
+                    index_patterns=ip["template_pat"].format(
+                        prefix=self.idx_prefix, version=idxver, idxname=idxname
+                    ),
+                    settings=tool_settings,
+                    mappings=rollup_mapping,
+                )
+                self.templates[rollup_template_name] = rollup_template_body
+                self.versions[idxname] = idxver
+
         # Add a standard "authorization" sub-document into each of the
         # document templates we've collected. With the single exception
         # of the server reports template, which isn't owned by any
@@ -204,7 +256,72 @@ class PbenchTemplates:
                     }
                 }
 
-        self.counters = Counter()
+        if cache_dir is not None:
+            self._save_cache(cache_dir, cache_key)
+
+    def _cache_key(self, *dirs):
+        """Return a digest of the names, sizes, and modification times of the
+        files in the given directories, along with the arguments shaping the
+        templates, identifying a cached set of templates loaded from them.
+        """
+        files = []
+        for dirname in dirs:
+            for entry in sorted(os.scandir(dirname), key=lambda e: e.name):
+                if entry.is_file():
+                    st = entry.stat()
+                    files.append([entry.path, st.st_size, st.st_mtime_ns])
+        tool_handlers = (
+            None
+            if self.known_tool_handlers is None
+            else sorted(self.known_tool_handlers)
+        )
+        key = [
+            self._cache_format,
+            self.idx_prefix,
+            tool_handlers,
+            self.tool_data_rollups,
+            files,
+        ]
+        return hashlib.sha256(json.dumps(key).encode("utf-8")).hexdigest()
+
+    def _load_cache(self, cache_dir, cache_key):
+        """Load the templates and their versions from the cache file in the
+        given directory, returning False if it is missing, unreadable, or was
+        not recorded for the given key.
+        """
+        cache_fn = os.path.join(cache_dir, self._cache_name)
+        try:
+            with open(cache_fn, "r") as cachefp:
+                cache = json.load(cachefp)
+            if cache["key"] != cache_key:
+                return False
+            templates, versions = cache["templates"], cache["versions"]
+        except FileNotFoundError:
+            return False
+        except (OSError, ValueError, KeyError, TypeError) as exc:
+            self.logger.warning("Ignoring template cache {}: {}", cache_fn, exc)
+            return False
+        self.templates, self.versions = templates, versions
+        return True
+
+    def _save_cache(self, cache_dir, cache_key):
+        """Record the loaded templates and their versions in the cache file in
+        the given directory, replacing it atomically so that concurrent
+        invocations never load a partial file.
+        """
+        cache_fn = os.path.join(cache_dir, self._cache_name)
+        tmp_fn = "{}.{:d}".format(cache_fn, os.getpid())
+        cache = dict(key=cache_key, templates=self.templates, versions=self.versions)
+        try:
+            with open(tmp_fn, "w") as cachefp:
+                json.dump(cache, cachefp)
+            os.replace(tmp_fn, cache_fn)
+        except OSError as exc:
+            self.logger.warning("Unable to save template cache {}: {}", cache_fn, exc)
+            try:
+                os.unlink(tmp_fn)
+            except OSError:
+                pass
 
     index_patterns = {
         "result-data": {
@@ -259,6 +376,15 @@ class PbenchTemplates:
             "desc": "Daily tool data for all tools land in indices"
             " named by tool; e.g. prefix.v0.tool-data-iostat.YYYY-MM-DD",
         },
+        "tool-data-rollup": {
+            "idxname": "tool-data-rollup-{tool}",
+            "template_name": "{prefix}.v{version}.{idxname}",
+            "template_pat": "{prefix}.v{version}.{idxname}.*",
+            "template": "{prefix}.v{version}.{idxname}.{year}-{month}",
+            "desc": "Monthly tool data rollups (min, max, avg, and p95 of"
+            " each metric per minute and per sample) land in indices named by"
+            " tool; e.g. prefix.v0.tool-data-rollup-iostat.YYYY-MM",
+        },
     }
 
     def dump_idx_patterns(self):
@@ -266,7 +392,9 @@ class PbenchTemplates:
         pattern_names = [idx for idx in patterns]
         pattern_names.sort()
         for idx in pattern_names:
-            if idx != "tool-data":
+            if idx == "tool-data-rollup" and not self.tool_data_rollups:
+                continue
+            if idx not in ("tool-data", "tool-data-rollup"):
                 idxname = patterns[idx]["idxname"]
                 print(
                     patterns[idx]["template"].format(
@@ -311,8 +439,33 @@ class PbenchTemplates:
             )
         sys.stdout.flush()
 
+    def _installed_versions(self, es):
+        """Return the versions of all the installed templates with our prefix,
+        fetched with a single request, or an empty dictionary if they could
+        not be fetched.
+        """
+        try:
+            installed = es.indices.get_template(
+                name="{}.*".format(self.idx_prefix), ignore=404
+            )
+        except Exception as exc:
+            self.logger.warning("Unable to fetch installed templates: {}", exc)
+            return {}
+        versions = {}
+        for name, tmpl in installed.items():
+            try:
+                versions[name] = str(tmpl["mappings"]["_meta"]["version"])
+            except (KeyError, TypeError):
+                pass
+        return versions
+
     def update_templates(self, es, target_name=None):
         """Push the various Elasticsearch index templates required by pbench.
+
+        A template is only pushed when the installed one's version differs
+        from ours, which is also the only case where pyesbulk replaces it.
+        Checking the versions of all the installed templates up front saves
+        a round trip to Elasticsearch for each unchanged one.
         """
         if target_name is not None:
             idxname = self.index_patterns[target_name]["idxname"]
@@ -320,19 +473,21 @@ class PbenchTemplates:
             idxname = None
         template_names = [name for name in self.templates]
         template_names.sort()
-        successes = retries = 0
+        installed = self._installed_versions(es)
+        successes = retries = unchanged = 0
         beg = end = None
         for name in template_names:
             if idxname is not None and not name.endswith(idxname):
                 # If we were asked to only load a given template name, skip
                 # all non-matching templates.
                 continue
+            body = self.templates[name]
+            if installed.get(name) == str(body["mappings"]["_meta"]["version"]):
+                unchanged += 1
+                continue
             try:
                 _beg, _end, _retries, _stat = pyesbulk.put_template(
-                    es,
-                    name,
-                    "pbench-{}".format(name.split(".")[2]),
-                    self.templates[name],
+                    es, name, "pbench-{}".format(name.split(".")[2]), body
                 )
             except Exception as e:
                 self.counters["put_template_failures"] += 1
@@ -343,6 +498,9 @@ class PbenchTemplates:
                     beg = _beg
                 end = _end
                 retries += _retries
+        if beg is None:
+            self.logger.debug("done templates (unchanged: {:d})", unchanged)
+            return
         log_action = self.logger.warning if retries > 0 else self.logger.debug
         log_action(
             "done templates (start ts: {}, end ts: {}, duration: {:.2f}s,"
@@ -0,0 +1,101 @@
+"""Upload benchmark.
+
+Measure how fast the Upload API receives the body of a request: the body is
+read from a local file through a Flask test request context, written to a
+temporary file in the same directory, and hashed, as Upload.put() does, but
+without the authentication and the dataset tracking around it.
+
+The report gives the MB/s of the legacy receive loop, reading 4 KiB at a
+time, and of Upload._receive(), for comparison.  Run it via "python3 -m
+pbench.server.upload_benchmark [<size in MiB> [<directory>]]", where the
+directory (default: a temporary one) should be on the file system of the
+receive directory being tuned.
+"""
+
+import hashlib
+import os
+import sys
+import tempfile
+import time
+
+from flask import Flask, request
+
+from pbench.server.api.resources.upload_api import Upload
+
+
+def _receive_4k(ofp, content_length, hash_md5):
+    """The legacy receive loop of Upload.put(), for comparison."""
+    chunk_size = 4096
+    bytes_received = 0
+    while True:
+        chunk = request.stream.read(chunk_size)
+        bytes_received += len(chunk)
+        if len(chunk) == 0 or bytes_received > content_length:
+            break
+
+        ofp.write(chunk)
+        hash_md5.update(chunk)
+    return bytes_received
+
+
+def _receive_buffered(ofp, content_length, hash_md5):
+    Upload._preallocate(ofp, content_length)
+    return Upload._receive(ofp, content_length, hash_md5)
+
+
+_RECEIVERS = [("4 KiB reads", _receive_4k), ("large buffer", _receive_buffered)]
+
+
+def _make_source(path, size):
+    """Write a file of the given size of random data, returning its MD5."""
+    hash_md5 = hashlib.md5()
+    block = os.urandom(1024 * 1024)
+    with open(path, "wb") as fp:
+        remaining = size
+        while remaining > 0:
+            data = block[:remaining]
+            fp.write(data)
+            hash_md5.update(data)
+            remaining -= len(data)
+    return hash_md5.hexdigest()
+
+
+def run(size, directory):
+    """Receive a body of the given size with each receive loop, returning a
+    list of (name, seconds, MB/s) tuples.
+    """
+    app = Flask("upload-benchmark")
+    source = os.path.join(directory, "upload-benchmark.src")
+    md5sum = _make_source(source, size)
+    results = []
+    try:
+        for name, receive in _RECEIVERS:
+            with open(source, "rb") as ifp, app.test_request_context(
+                "/", method="PUT", input_stream=ifp, content_length=size
+            ), tempfile.NamedTemporaryFile(mode="wb", dir=directory) as ofp:
+                hash_md5 = hashlib.md5()
+                start = time.perf_counter()
+                bytes_received = receive(ofp, size, hash_md5)
+                ofp.flush()
+                elapsed = time.perf_counter() - start
+            if bytes_received != size or hash_md5.hexdigest() != md5sum:
+                raise RuntimeError(f"{name}: received data does not match")
+            results.append((name, elapsed, size / elapsed / 1e6))
+    finally:
+        os.remove(source)
+    return results
+
+
+def main(argv):
+    size = int(argv[1]) if len(argv) > 1 else 1024
+    directory = argv[2] if len(argv) > 2 else None
+    with tempfile.TemporaryDirectory(dir=directory) as tmp_d:
+        results = run(size * 1024 * 1024, tmp_d)
+    print(f"Received {size:d} MiB:")
+    for name, elapsed, rate in results:
+        print(f"    {name:<12s} {elapsed:8.3f} secs {rate:10.1f} MB/s")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
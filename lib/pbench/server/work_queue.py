@@ -0,0 +1,185 @@
+"""Work queue of the datasets waiting for the server's long-running workers.
+
+A dataset is queued in the "work_queue" table of the tracker database, keyed
+by the state it is in, as soon as it reaches a state a worker acts upon: the
+Upload API (and the prep shim, for tar balls copied by agents) queues each
+dataset once it is UPLOADED, and the worker unpacking it queues it again once
+UNPACKED, for indexing (see pbench.server.dataset_worker).
+
+Workers claim the oldest item for the states they process with "SELECT ...
+FOR UPDATE SKIP LOCKED", in a transaction of their own which holds the row
+lock until the item is done.  Any number of workers can share the queue
+without claiming the same item, and the item of a worker which dies is
+claimed again by another one.  On PostgreSQL, queueing an item NOTIFYs the
+idle workers, which otherwise poll the queue.
+
+An item whose work fails is retried after a delay doubling with each failed
+attempt, up to MAX_ATTEMPTS attempts; the dataset is then left to the cron
+job of its stage, or the admin, to recover from its state link.
+
+This is enabled with "dataset-work-queue = yes" in the "pbench-server"
+section of the configuration; the symlink tree is still maintained by the
+stages the workers run, as a view compatible with the cron driven scripts.
+"""
+
+import datetime
+import select
+import time
+
+from sqlalchemy import text
+from sqlalchemy.exc import IntegrityError, SQLAlchemyError
+from sqlalchemy.orm import sessionmaker
+
+from pbench.server.database.database import Database
+from pbench.server.database.models.tracker import WorkItem
+
+# The PostgreSQL channel on which the queueing of items is notified.
+CHANNEL = "pbench_work_queue"
+
+# The number of attempts at the work of an item before giving up on it, and
+# the delay (seconds) before the first retry, doubling with each retry up to
+# the maximum given.
+MAX_ATTEMPTS = 10
+RETRY_DELAY = 60
+MAX_RETRY_DELAY = 6 * 60 * 60
+
+
+def _notify(session):
+    if session.get_bind().dialect.name == "postgresql":
+        session.execute(text(f"NOTIFY {CHANNEL}"))
+
+
+class WorkQueue:
+    """The items of the work queue for the given dataset states, as claimed
+    by a worker.
+    """
+
+    def __init__(self, states, logger):
+        self.states = states
+        self.logger = logger
+        self.engine = Database.db_session.get_bind()
+        # The claimed items are locked by a transaction of their own, which
+        # the Dataset updates made while processing them do not commit, on a
+        # connection of its own.
+        self._conn = self.engine.connect()
+        self._listener = None
+        if self.engine.dialect.name == "postgresql":
+            # The transaction stays idle for as long as the stage run for the
+            # claimed item, hours when indexing a large tar ball: exempt it
+            # from any idle_in_transaction_session_timeout of the server,
+            # which would otherwise drop the lock, and the item, midway.
+            # (It also holds back the VACUUM of rows deleted meanwhile.)
+            with self._conn.begin():
+                self._conn.execute(text("SET idle_in_transaction_session_timeout = 0"))
+            # Listen before the first claim, so that no item queued after it
+            # is missed.
+            self._listener = self.engine.raw_connection()
+            self._listener.connection.autocommit = True
+            cursor = self._listener.cursor()
+            cursor.execute(f"LISTEN {CHANNEL}")
+            cursor.close()
+        self.session = sessionmaker(bind=self._conn)()
+
+    @staticmethod
+    def enabled(config, logger):
+        try:
+            return config.conf.getboolean(
+                "pbench-server", "dataset-work-queue", fallback=False
+            )
+        except ValueError as e:
+            logger.warning("Dataset work queue disabled, bad config: {}", e)
+            return False
+
+    @staticmethod
+    def enqueue(dataset, logger):
+        """Queue the given dataset, keyed by its current state, returning True
+        if it was queued, or already was.
+        """
+        session = Database.db_session
+        try:
+            session.add(WorkItem(dataset_ref=dataset.id, state=dataset.state))
+            _notify(session)
+            session.commit()
+        except IntegrityError:
+            session.rollback()
+            logger.debug("{} is already queued for {}", dataset, dataset.state)
+        except SQLAlchemyError:
+            session.rollback()
+            logger.exception("Unable to queue {} for {}", dataset, dataset.state)
+            return False
+        return True
+
+    def claim(self):
+        """Claim the oldest item queued for our states that no other worker
+        holds, and that is ready to be retried, if it failed before,
+        returning it, or None if there is none.
+        """
+        item = (
+            self.session.query(WorkItem)
+            .filter(WorkItem.state.in_(self.states))
+            .filter(WorkItem.ready <= datetime.datetime.now())
+            .order_by(WorkItem.queued, WorkItem.id)
+            .with_for_update(skip_locked=True)
+            .first()
+        )
+        if item is None:
+            self.session.rollback()
+        return item
+
+    def done(self, item, next_state=None):
+        """Remove the claimed item from the queue, queueing its dataset again
+        for the given next state, if any, at the same time.
+        """
+        item_id, dataset_ref = item.id, item.dataset_ref
+        self.session.delete(item)
+        if next_state is not None:
+            queued = (
+                self.session.query(WorkItem)
+                .filter_by(dataset_ref=dataset_ref, state=next_state)
+                .first()
+            )
+            if queued is None:
+                self.session.add(WorkItem(dataset_ref=dataset_ref, state=next_state))
+                _notify(self.session)
+        try:
+            self.session.commit()
+        except IntegrityError:
+            # Another component queued the dataset for the next state first.
+            self.session.rollback()
+            self.session.query(WorkItem).filter_by(id=item_id).delete()
+            self.session.commit()
+
+    def retry(self, item):
+        """Release the claimed item, whose work failed, to be claimed again
+        after the retry delay, returning False if it was given up on instead.
+        """
+        item.attempts += 1
+        if item.attempts >= MAX_ATTEMPTS:
+            self.logger.error(
+                "Giving up on work item {} after {:d} attempts", item, item.attempts
+            )
+            self.session.delete(item)
+            self.session.commit()
+            return False
+        delay = min(RETRY_DELAY * 2 ** (item.attempts - 1), MAX_RETRY_DELAY)
+        item.ready = datetime.datetime.now() + datetime.timedelta(seconds=delay)
+        self.session.commit()
+        return True
+
+    def release(self):
+        """Release the claimed item, leaving it queued."""
+        self.session.rollback()
+
+    def wait(self, timeout):
+        """Wait until an item is queued, or for the given number of seconds,
+        whichever comes first.
+        """
+        if self._listener is None:
+            time.sleep(timeout)
+            return
+        conn = self._listener.connection
+        conn.poll()
+        if not conn.notifies:
+            select.select([conn], [], [], timeout)
+            conn.poll()
+        del conn.notifies[:]
@@ -5,7 +5,7 @@ import pytest
 import responses
 
 from pbench.agent import PbenchAgentConfig
-from pbench.agent.results import CopyResultTb
+from pbench.agent.results import CopyResultTb, FileUploadError
 from pbench.common.logger import get_pbench_logger
 from pbench.test.unit.agent.task.common import tarball, bad_tarball
 
@@ -30,6 +30,65 @@ class TestCopyResults:
         crt = CopyResultTb("controller", tarball, self.config, self.logger)
         crt.copy_result_tb("token")
 
+    @responses.activate
+    def test_copy_tar_parts(self, valid_config):
+        session_url = "http://pbench.example.com/api/v1/upload/session/controller"
+        session_id = "0123456789abcdef0123456789abcdef"
+        responses.add(
+            responses.POST, session_url, json={"session_id": session_id}, status=201
+        )
+        parts = {}
+
+        def put_part(request):
+            body = request.body
+            if not isinstance(body, bytes):
+                body = body.read()
+            parts[request.headers["Content-Range"]] = body
+            return 200, {}, "{}"
+
+        responses.add_callback(
+            responses.PUT, f"{session_url}/{session_id}/part", callback=put_part
+        )
+        responses.add(responses.POST, f"{session_url}/{session_id}", status=201)
+        crt = CopyResultTb("controller", tarball, self.config, self.logger)
+        crt.upload_part_size = 256
+        crt.upload_concurrency = 2
+        crt.copy_result_tb("token")
+
+        with open(tarball, "rb") as fp:
+            data = fp.read()
+        assert len(data) == 640
+        assert parts == {
+            "bytes 0-255/640": data[:256],
+            "bytes 256-511/640": data[256:512],
+            "bytes 512-639/640": data[512:],
+        }
+
+    @responses.activate
+    def test_copy_tar_parts_exists(self, valid_config):
+        session_url = "http://pbench.example.com/api/v1/upload/session/controller"
+        crt = CopyResultTb("controller", tarball, self.config, self.logger)
+        crt.upload_part_size = 256
+        crt.upload_concurrency = 2
+
+        # The tarball is uploaded already.
+        responses.add(
+            responses.POST,
+            session_url,
+            json={"message": "Dataset already exists", "state": "UPLOADED"},
+            status=200,
+        )
+        crt.copy_result_tb("token")
+
+        # The tarball is still being uploaded, or the server does not say.
+        for body in (
+            {"message": "Dataset already exists", "state": "UPLOADING"},
+            {"message": "Dataset already exists"},
+        ):
+            responses.replace(responses.POST, session_url, json=body, status=200)
+            with pytest.raises(FileUploadError):
+                crt.copy_result_tb("token")
+
     @responses.activate
     def test_bad_tar(self, caplog, valid_config):
         responses.add(
@@ -1,9 +1,12 @@
 import shutil
 import tempfile
 import pytest
+from argparse import Namespace
 from pathlib import Path
+from pbench.common.logger import get_pbench_logger
 from pbench.server.api import create_app, get_server_config
 from pbench.server.api.auth import Auth
+from pbench.server.indexer import IdxContext
 
 
 server_cfg_tmpl = """[DEFAULT]
@@ -27,6 +30,9 @@ port = 7081
 [logging]
 logger_type = file
 
+[pbench-unit-tests]
+logging_level = DEBUG
+
 [Indexing]
 index_prefix = unit-test
 
@@ -64,6 +70,10 @@ def setup(request, pytestconfig):
     pbench_archive = srv_pbench / "archive" / "fs-version-001"
     pbench_archive.mkdir(parents=True, exist_ok=True)
 
+    # "Install" the Elasticsearch mappings and settings used for indexing.
+    for d in ("mappings", "settings"):
+        shutil.copytree(f"./server/lib/{d}", str(opt_pbench / "lib" / d))
+
     # "Install" the default server configuration file.
     shutil.copyfile(
         "./server/lib/config/pbench-server-default.cfg",
@@ -93,6 +103,21 @@ def server_config(pytestconfig, monkeypatch):
     return server_config
 
 
+@pytest.fixture
+def server_logger(server_config):
+    """A pbench server logger, whose messages are captured by caplog."""
+    return get_pbench_logger("pbench-unit-tests", server_config)
+
+
+@pytest.fixture
+def idxctx(pytestconfig, server_config):
+    """An indexing context for the unit test configuration."""
+    cfg_file = pytestconfig.cache.get("_PBENCH_SERVER_CONFIG", None)
+    ctx = IdxContext(Namespace(cfg_name=cfg_file), "pbench-unit-tests")
+    ctx.set_tracking_id("unit-test-tracking-id")
+    return ctx
+
+
 @pytest.fixture
 def client(server_config):
     """A test client for the app."""
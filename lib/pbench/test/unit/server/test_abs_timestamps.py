@@ -0,0 +1,158 @@
+from argparse import Namespace
+from datetime import datetime, timedelta
+
+import pytest
+
+from pbench.common.exceptions import BadDate
+from pbench.server.indexer import _STD_DATETIME_FMT, PbenchData
+
+
+def _baseline_mk_abs_timestamp_millis(self, orig_ts):
+    """The original conversion of a single timestamp, without the memo."""
+    try:
+        orig_ts_float = float(orig_ts)
+    except Exception as e:
+        self.counters["ts_not_epoch_millis_float"] += 1
+        raise BadDate(
+            "{!r} is not a float in milliseconds since the"
+            " epoch: {}".format(orig_ts, e)
+        )
+    ts_float = orig_ts_float / 1000
+    try:
+        ts = datetime.utcfromtimestamp(ts_float)
+    except Exception as e:
+        self.counters["ts_not_epoch_float"] += 1
+        raise BadDate(
+            "{:f} ({!r}) is not a proper float in seconds since"
+            " the epoch: {}".format(ts_float, orig_ts, e)
+        )
+    if ts < self.ptb.start_run_ts:
+        try:
+            d = timedelta(0, 0, orig_ts_float * 1000)
+        except Exception as e:
+            self.counters["ts_calc_not_epoch_millis_float"] += 1
+            raise BadDate(
+                "{:f} ({!r}) is not a proper float in"
+                " milliseconds since the epoch: {}".format(orig_ts_float, orig_ts, e)
+            )
+        newts = self.ptb.start_run_ts + d
+        if newts > self.ptb.end_run_ts:
+            self.counters["ts_before_start_run_ts"] += 1
+            raise BadDate(
+                "{} ({!r}) is before the start of the"
+                " run ({})".format(ts, orig_ts, self.ptb.start_run_ts)
+            )
+        else:
+            ts = newts
+    elif ts > self.ptb.end_run_ts:
+        self.counters["ts_after_end_run_ts"] += 1
+        raise BadDate(
+            "{} ({!r}) is after the end of the"
+            " run ({})".format(ts, orig_ts, self.ptb.end_run_ts)
+        )
+    return ts.strftime(_STD_DATETIME_FMT)
+
+
+def _pd(start, end):
+    ptb = Namespace(
+        start_run_ts=start,
+        end_run_ts=end,
+        idxctx=Namespace(logger=None),
+        run_metadata=dict(
+            id="abc",
+            controller="ctrl",
+            name="run",
+            script="fio",
+            date="",
+            start="",
+            end="",
+        ),
+    )
+    return PbenchData(ptb)
+
+
+def _ms(ts):
+    return (ts - datetime(1970, 1, 1)).total_seconds() * 1000
+
+
+def _call(f, orig_ts):
+    try:
+        return f(orig_ts)
+    except Exception as e:
+        return type(e).__name__, str(e)
+
+
+def _timestamps(start, end):
+    start_ms, end_ms = _ms(start), _ms(end)
+    return [
+        # Absolute timestamps within the run, repeated, and at or near its
+        # bounds.
+        str(start_ms + 1500),
+        repr(start_ms + 1500.25),
+        str(start_ms + 1500),
+        str(start_ms),
+        str(start_ms + 0.4),
+        str(start_ms + 1),
+        str(end_ms - 1),
+        str(end_ms - 0.6),
+        str(end_ms),
+        int(start_ms + 2000),
+        # Relative timestamps, within and beyond the run.
+        "0",
+        "1000.5",
+        "1000.5",
+        str(end_ms - start_ms + 1),
+        "-1000",
+        # Absolute timestamps outside the run.
+        str(start_ms - 1),
+        str(end_ms + 1),
+        str(end_ms + 86400000),
+        # Not timestamps at all, or out of range.
+        "abc",
+        "",
+        None,
+        "nan",
+        "inf",
+        "-inf",
+        "1e20",
+        "-1e20",
+        "-6e13",
+    ]
+
+
+_RUNS = [
+    (datetime(2020, 2, 3, 4, 5, 6, 789000), datetime(2020, 2, 3, 5, 6, 7, 1000)),
+    (datetime(1970, 1, 1, 0, 0, 1), datetime(1970, 1, 2)),
+    # Years before 1000 are not zero padded.
+    (datetime(999, 1, 1), datetime(999, 1, 2)),
+]
+
+
+class TestAbsTimestamps:
+    @staticmethod
+    @pytest.mark.parametrize("start,end", _RUNS)
+    def test_single(start, end):
+        baseline, pd = _pd(start, end), _pd(start, end)
+        baseline_f = _baseline_mk_abs_timestamp_millis.__get__(baseline)
+        for orig_ts in _timestamps(start, end) * 2:
+            expected = _call(baseline_f, orig_ts)
+            assert _call(pd.mk_abs_timestamp_millis, orig_ts) == expected, orig_ts
+        assert pd.counters == baseline.counters
+
+    @staticmethod
+    @pytest.mark.parametrize("start,end", _RUNS)
+    def test_batch(start, end):
+        baseline, pd = _pd(start, end), _pd(start, end)
+        baseline_f = _baseline_mk_abs_timestamp_millis.__get__(baseline)
+        timestamps = _timestamps(start, end)
+        batch = pd.mk_abs_timestamps_millis(timestamps)
+        assert len(batch) == len(timestamps)
+        # Plainly absolute timestamps within the run are normalized.
+        assert batch[0] is not None and batch[-1] is None
+        for orig_ts, ts_str in zip(timestamps, batch):
+            expected = _call(baseline_f, orig_ts)
+            if ts_str is None:
+                # Left to the caller, in row order.
+                ts_str = _call(pd.mk_abs_timestamp_millis, orig_ts)
+            assert ts_str == expected, orig_ts
+        assert pd.counters == baseline.counters
@@ -0,0 +1,110 @@
+import io
+import json
+
+from elasticsearch import ConnectionError, ConnectionTimeout, TransportError
+
+from pbench.server import bulk
+
+
+class FakeES:
+    """Answer bulk requests based on the "_id" of each action: "dup" is a
+    duplicate, "bad" fails, and "busy" is rejected the first time around.
+    """
+
+    def __init__(self, fail_requests=0):
+        self.fail_requests = fail_requests
+        self.seen = set()
+        self.requests = 0
+
+    def bulk(self, body, request_timeout=None):
+        self.requests += 1
+        if self.fail_requests > 0:
+            self.fail_requests -= 1
+            raise ConnectionTimeout("TIMEOUT", "timed out", None)
+        lines = body.splitlines()
+        items = []
+        for header in lines[::2]:
+            _id = json.loads(header)["create"]["_id"]
+            if _id == "dup" or (_id == "busy" and _id not in self.seen):
+                status = 409 if _id == "dup" else 429
+            elif _id == "bad":
+                status = 400
+            else:
+                status = 201
+            self.seen.add(_id)
+            items.append({"create": {"_id": _id, "status": status}})
+        return {"items": items}
+
+
+def _actions(ids):
+    for _id in ids:
+        yield {
+            "_op_type": "create",
+            "_index": "unit-test.idx",
+            "_id": _id,
+            "_source": {"a": _id} if _id != "enc" else '{"a":"enc"}',
+        }
+
+
+class TestConcurrentBulk:
+    @staticmethod
+    def test_counts(monkeypatch, server_logger):
+        monkeypatch.setattr(bulk.time, "sleep", lambda secs: None)
+        ids = [f"id{i}" for i in range(1200)] + ["dup", "bad", "busy", "enc"]
+        errorsfp = io.StringIO()
+        res = bulk.concurrent_bulk(
+            FakeES(), _actions(ids), errorsfp, server_logger, 4, 10, 60
+        )
+        beg, end, successes, duplicates, failures, retries = res
+        assert beg <= end
+        assert (successes, duplicates, failures, retries) == (1202, 1, 1, 1)
+        errors = [json.loads(line) for line in errorsfp.getvalue().splitlines()]
+        assert [e["action"]["_id"] for e in errors] == ["bad"]
+
+    @staticmethod
+    def test_request_retry(monkeypatch, server_logger, caplog):
+        monkeypatch.setattr(bulk.time, "sleep", lambda secs: None)
+        es = FakeES(fail_requests=2)
+        res = bulk.concurrent_bulk(
+            es, _actions(["a", "b"]), io.StringIO(), server_logger, 2, 10, 60
+        )
+        assert res[2:] == (2, 0, 0, 4)
+        assert es.requests == 3
+        assert [r.levelname for r in caplog.records] == ["WARNING"] * 2
+
+    @staticmethod
+    def test_request_failure(server_logger):
+        class BrokenES:
+            @staticmethod
+            def bulk(body, request_timeout=None):
+                raise TransportError(400, "bad request", None)
+
+        errorsfp = io.StringIO()
+        res = bulk.concurrent_bulk(
+            BrokenES(), _actions(["a", "b"]), errorsfp, server_logger, 2, 10, 60
+        )
+        assert res[2:] == (0, 0, 2, 0)
+        assert len(errorsfp.getvalue().splitlines()) == 2
+
+    @staticmethod
+    def test_unreachable(monkeypatch, server_logger):
+        monkeypatch.setattr(bulk.time, "sleep", lambda secs: None)
+
+        class UnreachableES:
+            requests = 0
+
+            def bulk(self, body, request_timeout=None):
+                self.requests += 1
+                raise ConnectionError("N/A", "connection refused", None)
+
+        es = UnreachableES()
+        errorsfp = io.StringIO()
+        res = bulk.concurrent_bulk(
+            es, _actions(["a", "b"]), errorsfp, server_logger, 2, 10, 60
+        )
+        # The actions are retried a bounded number of times, and then
+        # reported as failures.
+        assert res[2:] == (0, 0, 2, 2 * bulk._MAX_RETRIES)
+        assert es.requests == bulk._MAX_RETRIES + 1
+        errors = [json.loads(line) for line in errorsfp.getvalue().splitlines()]
+        assert [e["retry_count"] for e in errors] == [bulk._MAX_RETRIES] * 2
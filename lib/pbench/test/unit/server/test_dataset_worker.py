@@ -0,0 +1,97 @@
+import pytest
+
+from pbench.server.database.models.tracker import States
+from pbench.server.dataset_worker import DatasetWorker, RetryLater
+
+
+class _Dataset:
+    controller = "frodo"
+    name = "fio"
+
+
+class _Queue:
+    def __init__(self, item):
+        self.item = item
+        self.calls = []
+
+    def claim(self):
+        item, self.item = self.item, None
+        return item
+
+    def done(self, item, next_state=None):
+        self.calls.append(("done", next_state))
+
+    def retry(self, item):
+        self.calls.append(("retry", None))
+        return True
+
+
+class _Item:
+    dataset_ref = 1
+    state = States.UNPACKED
+
+
+@pytest.fixture
+def worker(tmp_path, server_config, server_logger, monkeypatch):
+    worker = DatasetWorker(server_config, server_logger, None)
+    worker.archive = tmp_path
+    ran = []
+    monkeypatch.setattr(worker, "_run", lambda *args, locks=(): ran.append(locks))
+    worker.ran = ran
+    return worker
+
+
+class TestDatasetWorker:
+    @staticmethod
+    def test_index(worker):
+        controller = worker.archive / _Dataset.controller
+        tb = controller / "fio.tar.xz"
+        link = controller / "TO-INDEX" / "fio.tar.xz"
+        link.parent.mkdir(parents=True)
+        tb.write_bytes(b"tar ball")
+        link.symlink_to(tb)
+
+        # A stage which did not get to the tar ball, e.g. because its cron
+        # job held the lock, leaves the link where it was.
+        with pytest.raises(RetryLater):
+            worker.index(_Dataset())
+        assert worker.ran == [["pbench-index.lock"]]
+
+        # A stage which moved the link, to the next state or to an error
+        # directory, is done.
+        (controller / "INDEXED").mkdir()
+        link.rename(controller / "INDEXED" / "fio.tar.xz")
+        assert worker.index(_Dataset()) is None
+
+    @staticmethod
+    def test_process_one(worker, monkeypatch, caplog):
+        class _Session:
+            @staticmethod
+            def query(cls):
+                return _Session
+
+            @staticmethod
+            def get(ref):
+                return _Dataset()
+
+            @staticmethod
+            def remove():
+                pass
+
+        monkeypatch.setattr(
+            "pbench.server.dataset_worker.Database.db_session", _Session, raising=False
+        )
+
+        def fail(dataset):
+            raise RetryLater("still in TO-INDEX")
+
+        for stage, expected in (
+            (fail, ("retry", None)),
+            (lambda dataset: None, ("done", None)),
+        ):
+            worker.queue = _Queue(_Item())
+            worker.stages[States.UNPACKED] = stage
+            assert worker.process_one()
+            assert not worker.process_one()
+            assert worker.queue.calls == [expected]
+        assert any(r.levelname == "WARNING" for r in caplog.records)
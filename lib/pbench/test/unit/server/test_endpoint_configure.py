@@ -61,6 +61,8 @@ class TestEnpointConfig:
                 "user": f"{uri}/user/",
                 "host_info": f"{uri}/host_info",
                 "upload_ctrl": f"{uri}/upload/ctrl/",
+                "upload_session": f"{uri}/upload/session/",
+                "upload_session_part": f"{uri}/upload/session/part",
             },
         }
 
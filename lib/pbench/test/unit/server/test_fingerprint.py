@@ -0,0 +1,94 @@
+import hashlib
+import json
+import os
+
+from pbench.server import fingerprint
+from pbench.server.database.models.tracker import Metadata, MetadataNotFound
+from pbench.server.fingerprint import Fingerprints
+
+
+class _Meta:
+    def __init__(self, store, key, value):
+        self.store = store
+        self.key = key
+        self.value = value
+
+    def update(self):
+        self.store[self.key] = self.value
+
+
+class TestFingerprints:
+    @staticmethod
+    def test_trust(tmp_path, monkeypatch, server_config, server_logger):
+        store = {}
+
+        def get(dataset, key):
+            if key not in store:
+                raise MetadataNotFound(dataset, key)
+            return _Meta(store, key, store[key])
+
+        def create(dataset, key, value):
+            store[key] = value
+
+        hashed = []
+
+        def md5sum(path):
+            hashed.append(path)
+            data = open(path, "rb").read()
+            return len(data), hashlib.md5(data).hexdigest()
+
+        monkeypatch.setattr(Metadata, "get", staticmethod(get))
+        monkeypatch.setattr(Metadata, "create", staticmethod(create))
+        monkeypatch.setattr(fingerprint, "md5sum", md5sum)
+
+        tb = tmp_path / "tb.tar.xz"
+        tb.write_bytes(b"tar ball")
+        md5 = hashlib.md5(b"tar ball").hexdigest()
+        server_config.conf.set("pbench-server", "checksum-fingerprints", "yes")
+        fps = Fingerprints(server_config, server_logger)
+        dataset = object()
+
+        # The upload records the fingerprint, which the next stage trusts.
+        fps.record(tb, md5, dataset)
+        assert json.loads(store[Metadata.FINGERPRINT])["md5"] == md5
+        assert fps.md5(tb, md5, dataset) == md5
+        assert hashed == []
+
+        # A changed tar ball is hashed again, and its mismatching MD5 sum is
+        # not recorded.
+        tb.write_bytes(b"tar bull")
+        os.utime(tb, ns=(1, 1))
+        assert fps.md5(tb, md5, dataset) != md5
+        assert hashed == [tb]
+        assert json.loads(store[Metadata.FINGERPRINT])["mtime_ns"] != 1
+
+        # A matching MD5 sum is recorded, and then trusted until the scrub
+        # interval elapses.
+        new_md5 = hashlib.md5(b"tar bull").hexdigest()
+        assert fps.md5(tb, new_md5, dataset) == new_md5
+        assert json.loads(store[Metadata.FINGERPRINT])["mtime_ns"] == 1
+        assert fps.md5(tb, new_md5, dataset) == new_md5
+        assert len(hashed) == 2
+        fps.scrub_secs = 0
+        assert fps.md5(tb, new_md5, dataset) == new_md5
+        assert len(hashed) == 3
+
+    @staticmethod
+    def test_disabled(tmp_path, monkeypatch, server_config, server_logger, caplog):
+        def no_metadata(*args, **kwargs):
+            raise AssertionError("unexpected fingerprint access")
+
+        monkeypatch.setattr(Metadata, "get", staticmethod(no_metadata))
+        monkeypatch.setattr(Metadata, "create", staticmethod(no_metadata))
+
+        tb = tmp_path / "tb.tar.xz"
+        tb.write_bytes(b"tar ball")
+        md5 = hashlib.md5(b"tar ball").hexdigest()
+        fps = Fingerprints(server_config, server_logger)
+        fps.record(tb, md5, object())
+        assert fps.md5(tb, md5, object()) == md5
+
+        server_config.conf.set("pbench-server", "checksum-fingerprints", "maybe")
+        bad = Fingerprints(server_config, server_logger)
+        assert not bad.enabled
+        assert caplog.records[-1].levelname == "WARNING"
@@ -0,0 +1,38 @@
+import tarfile
+
+import pytest
+
+from pbench.server.index_benchmark import BenchmarkShape, make_tarball
+
+
+class TestIndexBenchmark:
+    @staticmethod
+    def test_shape():
+        shape = BenchmarkShape.parse("hosts=3, rows=10")
+        assert (
+            str(shape)
+            == "iterations=2,samples=2,hosts=3,tools=3,columns=8,rows=10,files=0"
+        )
+        for spec in ("hosts", "hosts=x", "disks=2", "tools=4", "rows=0", "files=-1"):
+            with pytest.raises(ValueError):
+                BenchmarkShape.parse(spec)
+
+    @staticmethod
+    def test_make_tarball(tmp_path):
+        shape = BenchmarkShape(
+            iterations=1, samples=2, hosts=1, tools=2, columns=2, rows=5, files=101
+        )
+        tb_path, extracted_root = make_tarball(shape, str(tmp_path))
+        with tarfile.open(tb_path) as tb:
+            names = tb.getnames()
+        name = names[0]
+        csv_dir = f"{name}/1-synthetic/sample2/tools-default/host0.example.com"
+        assert f"{name}/metadata.log" in names
+        assert f"{csv_dir}/iostat/csv/disk_IOPS.csv" in names
+        assert f"{csv_dir}/mpstat/csv/cpu1_cpu1.csv" in names
+        assert not [n for n in names if "/vmstat" in n]
+        assert f"{name}/sysinfo/end/host0.example.com/dir1/file100" in names
+        iops = tmp_path / "incoming" / "bench-controller" / f"{csv_dir}/iostat/csv"
+        lines = (iops / "disk_IOPS.csv").read_text().splitlines()
+        assert lines[0] == "timestamp_ms,disk0-read,disk0-write,disk1-read,disk1-write"
+        assert len(lines) == 6
@@ -0,0 +1,84 @@
+from pbench.server.indexer import IndexedIds
+
+
+class _Indices:
+    def __init__(self, uuids):
+        self.uuids = uuids
+
+    def get_settings(self, index, name, ignore_unavailable):
+        assert name == "index.uuid" and ignore_unavailable
+        return {
+            i: {"settings": {"index": {"uuid": self.uuids[i]}}}
+            for i in index.split(",")
+            if i in self.uuids
+        }
+
+
+class _Es:
+    def __init__(self, **uuids):
+        self.indices = _Indices(uuids)
+
+
+def _actions(index, ids):
+    return [{"_index": index, "_id": i, "_source": {}} for i in ids]
+
+
+class TestIndexedIds:
+    @staticmethod
+    def test_reindex(tmp_path, server_logger, caplog):
+        path = tmp_path / "controller" / "tb.ids"
+        es = _Es(**{"idx.v1.run": "u1", "idx.v2.run": "u2"})
+        ids = IndexedIds(path, es, server_logger)
+        actions = _actions("idx.v1.run", ["a", "b", "c"])
+        assert list(ids.filter(actions[:2])) == actions[:2]
+        ids.indexed(0)
+        assert list(ids.filter(actions[2:])) == actions[2:]
+        # The last action failed, so it is not recorded.
+        ids.indexed(1)
+        ids.save()
+
+        ids = IndexedIds(path, es, server_logger)
+        assert len(ids) == 2
+        new_version = _actions("idx.v2.run", ["a"])
+        assert list(ids.filter(actions + new_version)) == actions[2:] + new_version
+        assert ids.skipped == 2
+        ids.indexed(0)
+        ids.save()
+        assert len(IndexedIds(path, es, server_logger)) == 4
+        assert not [r for r in caplog.records if r.levelname == "WARNING"]
+
+    @staticmethod
+    def test_recreated(tmp_path, server_logger, caplog):
+        path = tmp_path / "tb.ids"
+        es = _Es(**{"idx.v1.run": "u1", "idx.v1.tool": "u2"})
+        ids = IndexedIds(path, es, server_logger)
+        actions = _actions("idx.v1.run", ["a"]) + _actions("idx.v1.tool", ["b"])
+        assert list(ids.filter(actions)) == actions
+        ids.indexed(0)
+        ids.save()
+        assert len(IndexedIds(path, es, server_logger)) == 2
+
+        # Once any of the indices is deleted, or deleted and re-created,
+        # all documents are sent again.
+        del es.indices.uuids["idx.v1.tool"]
+        ids = IndexedIds(path, es, server_logger)
+        assert len(ids) == 0
+        assert caplog.messages[-1] == (
+            f"Ignoring indexed IDs {path}, their indices were re-created"
+        )
+        es.indices.uuids["idx.v1.tool"] = "u3"
+        ids = IndexedIds(path, es, server_logger)
+        assert list(ids.filter(actions)) == actions
+        ids.indexed(0)
+        ids.save()
+        assert len(IndexedIds(path, es, server_logger)) == 2
+
+    @staticmethod
+    def test_corrupt(tmp_path, server_logger, caplog):
+        path = tmp_path / "tb.ids"
+        es = _Es()
+        for data in (b"garbage", b"pbench-indexed-ids.v1\n", IndexedIds._header):
+            path.write_bytes(data)
+            ids = IndexedIds(path, es, server_logger)
+            assert len(ids) == 0
+            assert caplog.messages[-1] == f"Ignoring corrupt indexed IDs {path}"
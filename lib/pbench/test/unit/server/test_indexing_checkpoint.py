@@ -0,0 +1,94 @@
+from pbench.server.index_benchmark import BenchmarkShape, make_tarball
+from pbench.server.indexer import IndexingCheckpoint, PbenchTarBall
+
+
+_UNITS = [("1-iter", "sample1", "host", f"tool{i}") for i in range(10)]
+
+
+class TestIndexingCheckpoint:
+    @staticmethod
+    def test_resume():
+        ckpt = IndexingCheckpoint(_UNITS)
+        for unit in _UNITS[:3] + _UNITS[5:6]:
+            ckpt.unit_finished(unit)
+        # Finished units are not done until acknowledged.
+        assert not ckpt.is_done(_UNITS[0])
+        assert ckpt.acknowledged()
+        assert not ckpt.acknowledged()
+        value = ckpt.encode(2048)
+        assert value == f"{ckpt.digest}:0-2,5"
+
+        resumed = IndexingCheckpoint(_UNITS, value)
+        assert [u for u in _UNITS if resumed.is_done(u)] == _UNITS[:3] + _UNITS[5:6]
+
+    @staticmethod
+    def test_ignored():
+        ckpt = IndexingCheckpoint(_UNITS)
+        ckpt.unit_finished(_UNITS[0])
+        ckpt.acknowledged()
+        value = ckpt.encode(2048)
+        # A checkpoint for a different list of units, or a corrupt one, is
+        # ignored.
+        assert not IndexingCheckpoint(_UNITS[1:], value).done
+        assert not IndexingCheckpoint(_UNITS, f"{ckpt.digest}:0-x").done
+
+    @staticmethod
+    def test_truncated():
+        ckpt = IndexingCheckpoint(_UNITS)
+        for unit in _UNITS[::2]:
+            ckpt.unit_finished(unit)
+        ckpt.acknowledged()
+        value = ckpt.encode(len(ckpt.digest) + 6)
+        assert value == f"{ckpt.digest}:0,2,4"
+        assert IndexingCheckpoint(_UNITS, value).done == {0, 2, 4}
+
+    @staticmethod
+    def test_failed():
+        ckpt = IndexingCheckpoint(_UNITS)
+        ckpt.unit_finished(_UNITS[0])
+        assert ckpt.acknowledged(0)
+        ckpt.unit_finished(_UNITS[1])
+        # Units finished with failed actions are not done, nor are any
+        # finished afterwards, since they may have had actions in the
+        # failed segment.
+        assert not ckpt.acknowledged(1)
+        ckpt.unit_finished(_UNITS[2])
+        assert not ckpt.acknowledged(0)
+        assert ckpt.done == {0}
+
+    @staticmethod
+    def test_single_pass(idxctx, tmp_path):
+        shape = BenchmarkShape(
+            iterations=1, samples=1, hosts=1, tools=2, columns=1, rows=2, files=0
+        )
+        tb_path, extracted_root = make_tarball(shape, str(tmp_path))
+
+        def checkpointed(tool_data, single_pass, value=None):
+            """Generate the actions of a pass, with a checkpoint resumed from
+            the given value, returning the actions and the new value.
+            """
+            ptb = PbenchTarBall(idxctx, None, tb_path, str(tmp_path), extracted_root)
+            ckpt = ptb.mk_checkpoint(tool_data, value, single_pass=single_pass)
+            if single_pass:
+                actions = list(ptb.mk_single_pass_actions())
+            elif tool_data:
+                actions = list(ptb.mk_tool_data_actions())
+            else:
+                actions = list(ptb.make_all_actions())
+            ckpt.acknowledged(0)
+            return actions, ckpt.encode(2048)
+
+        everything, single_value = checkpointed(False, True)
+        first, first_value = checkpointed(False, False)
+        tools, tools_value = checkpointed(True, False)
+        assert len(everything) == len(first) + len(tools)
+
+        # A checkpoint recorded in either pass of the two-pass mode is ignored
+        # in single-pass mode, and vice versa.
+        for value in (first_value, tools_value):
+            actions, _ = checkpointed(False, True, value)
+            assert len(actions) == len(everything)
+        assert len(checkpointed(False, False, single_value)[0]) == len(first)
+        assert len(checkpointed(True, False, single_value)[0]) == len(tools)
+        # While one recorded in single-pass mode is resumed.
+        assert checkpointed(False, True, single_value)[0] == []
@@ -0,0 +1,76 @@
+from pbench.server.indexing_queue import IndexingQueue
+
+_TARBALLS = [
+    (5, "a", "a/TO-INDEX/a5.tar.xz"),
+    (1, "a", "a/TO-INDEX/a1.tar.xz"),
+    (2, "a", "a/TO-INDEX/a2.tar.xz"),
+    (3, "b", "b/TO-INDEX/b3.tar.xz"),
+    (100, "b", "b/TO-INDEX/b100.tar.xz"),
+    (200, "a", "a/TO-INDEX/a200.tar.xz"),
+]
+
+
+def _drain(tb_queue, in_flight=()):
+    names = []
+    while True:
+        item = tb_queue.next_tarball(in_flight)
+        if item is None:
+            return names
+        names.append(item[2].split("/")[-1][: -len(".tar.xz")])
+
+
+class _Clock:
+    def __init__(self):
+        self.now = 0.0
+
+    def __call__(self):
+        return self.now
+
+
+class TestIndexingQueue:
+    @staticmethod
+    def test_smallest_first():
+        tb_queue = IndexingQueue(_TARBALLS)
+        assert len(tb_queue) == 6
+        assert _drain(tb_queue) == ["a1", "a2", "b3", "a5", "b100", "a200"]
+        assert tb_queue.deferral_reason() is None
+
+    @staticmethod
+    def test_fair():
+        tb_queue = IndexingQueue(_TARBALLS, fair=True, fast_lane_size=10)
+        assert _drain(tb_queue) == ["a1", "b3", "a2", "a5", "b100", "a200"]
+
+    @staticmethod
+    def test_caps():
+        tb_queue = IndexingQueue(
+            _TARBALLS,
+            fair=True,
+            fast_lane_size=10,
+            fast_lane_bytes=3,
+            slow_lane_bytes=1,
+        )
+        # A lane may exceed its cap with the tar ball started before it
+        # was reached.
+        assert _drain(tb_queue) == ["a1", "b3", "b100"]
+        assert len(tb_queue) == 3
+        assert tb_queue.deferral_reason() == "fast and slow lane size cap reached"
+
+    @staticmethod
+    def test_time_budget():
+        clock = _Clock()
+        tb_queue = IndexingQueue(_TARBALLS, time_budget=10, clock=clock)
+        assert tb_queue.next_tarball()[2] == "a/TO-INDEX/a1.tar.xz"
+        clock.now = 10.0
+        assert tb_queue.next_tarball() is None
+        assert tb_queue.deferral_reason() == "time budget exhausted"
+
+    @staticmethod
+    def test_workers():
+        tb_queue = IndexingQueue(
+            [t for t in _TARBALLS if t[0] > 10], fair=True, fast_lane_size=10, workers=2
+        )
+        # One of the two workers is kept for the fast lane.
+        assert _drain(tb_queue, in_flight=[100]) == []
+        assert _drain(tb_queue, in_flight=[1]) == ["b100", "a200"]
+        tb_queue.reset([(1, "c", "c/TO-INDEX/c1.tar.xz")])
+        assert _drain(tb_queue, in_flight=[100]) == ["c1"]
@@ -0,0 +1,77 @@
+import copy
+import json
+
+from pbench.server import indexer
+from pbench.server.indexer import IndexingStats, SourceId
+
+
+def _action(template, source):
+    return {
+        "_op_type": "create",
+        "_index": f"unit-test.v1.{template}.2021-01",
+        "_id": "x",
+        "_source": source,
+    }
+
+
+_ACTIONS = [
+    _action("run", {"a": 1}),
+    _action("run-toc-entry", {"b": 2}),
+    _action("run-toc-entry", {"c": 3}),
+    _action("result-data-sample", '{"d":4}'),
+    _action("tool-data-iostat", {"e": 5}),
+]
+
+
+class TestIndexingStats:
+    @staticmethod
+    def test_indexed():
+        stats = IndexingStats()
+        expected = copy.deepcopy(_ACTIONS)
+
+        def es_index_f(actions):
+            actions = list(actions)
+            # The actions are handed to the bulk helper as generated.
+            assert actions == expected
+            return (0, 1, len(actions), 0, 0, 0)
+
+        assert stats.indexed(es_index_f, _ACTIONS) == (0, 1, 5, 0, 0, 0)
+        assert _ACTIONS == expected
+        res = stats.as_dict()
+        docs = {phase: entry["docs"] for phase, entry in res["phases"].items()}
+        assert docs == {
+            "bulk": 5,
+            "result-data": 1,
+            "run": 1,
+            "toc": 2,
+            "tool-data": 1,
+        }
+        # The first document of each phase not already encoded is sampled.
+        assert res["bytes_sample"] == indexer._BYTES_SAMPLE
+        sampled = indexer._BYTES_SAMPLE * len('{"a": 1}')
+        assert res["phases"]["toc"]["bytes"] == sampled
+        assert res["phases"]["result-data"]["bytes"] == 7
+        assert res["phases"]["bulk"]["bytes"] == 3 * sampled + 7
+        assert all(
+            isinstance(entry["wall_secs"], float) for entry in res["phases"].values()
+        )
+
+    @staticmethod
+    def test_tool_data_merge():
+        source_id = SourceId("id2")
+        source_id.encoded = '{"b":22}'
+        sources = [("idx", {"a": 1}, "id1"), ("idx", None, source_id)]
+        stats = IndexingStats()
+        stats.tarballs = 1
+        assert list(stats.timed_tool_data("iostat", sources)) == sources
+        total = IndexingStats()
+        total.merge(stats)
+        total.merge(stats)
+        res = total.as_dict()
+        assert res["tarballs"] == 2
+        assert res["tool_data_handlers"]["iostat"]["docs"] == 4
+        # The first document not already encoded is sampled.
+        assert res["tool_data_handlers"]["iostat"]["bytes"] == 2 * (
+            indexer._BYTES_SAMPLE * 8 + 8
+        )
+        json.dumps(res)
@@ -0,0 +1,282 @@
+import os
+from argparse import Namespace
+from pathlib import Path
+
+import pytest
+
+from pbench.common.exceptions import UnsupportedTarballFormat
+from pbench.server import indexing_tarballs
+from pbench.server.database.database import Database
+from pbench.server.database.models.tracker import Dataset, States
+from pbench.server.indexer import IndexingCheckpoint
+from pbench.server.indexing_queue import IndexingQueue
+from pbench.server.indexing_tarballs import Index
+
+
+# How indexing each tar ball ends, by name: successfully, with indexing
+# failures, with a tar ball error, or with an unexpected error.  The tar
+# balls are indexed in this order, smallest first.
+_TARBALLS = {
+    "ok-a": (0, 1, 10, 0, 0, 0),
+    "fail-b": (0, 1, 8, 0, 2, 0),
+    "nometa-c": UnsupportedTarballFormat("no metadata.log"),
+    "ok-d": (0, 1, 10, 0, 0, 0),
+    "boom-e": RuntimeError("boom"),
+}
+
+# The signal "received" while indexing the given tar ball, if any.
+_signals = {}
+
+
+class _Signal:
+    def __init__(self, flag, hook=None):
+        self.flag = flag
+        self.hook = hook
+
+
+def _outcome(path):
+    name = Path(path).name[: -len(".tar.xz")]
+    sig = _signals.pop(name, None)
+    if sig is not None:
+        sig.flag[0] = True
+        if sig.hook is not None:
+            sig.hook()
+    res = _TARBALLS[name]
+    if isinstance(res, Exception):
+        raise res
+    return res
+
+
+def _index_tb(self, idxctx, path, *args, **kwargs):
+    return _outcome(path)
+
+
+def _pool_index_tb(path, controller, username, tmpdir, ie_filepath):
+    index = indexing_tarballs._pool_index
+    try:
+        es_res = _outcome(path)
+    except Exception as e:
+        return index._tb_error(index.idxctx, e).name, None, None
+    return index._tb_indexed(index.idxctx, es_res).name, es_res, None
+
+
+class _Pool:
+    """A pool running each task when applied, in this process."""
+
+    def __init__(self, processes, initializer):
+        self.processes = processes
+
+    def apply_async(self, func, args, callback, error_callback):
+        try:
+            res = func(*args)
+        except Exception as e:
+            error_callback(e)
+        else:
+            callback(res)
+
+    def close(self):
+        pass
+
+    def terminate(self):
+        pass
+
+    def join(self):
+        pass
+
+
+@pytest.fixture
+def db(server_config, server_logger):
+    Database.init_db(server_config, server_logger)
+    yield Database.db_session
+    Database.db_session.remove()
+
+
+def _link(archive, name, linksrc="TO-INDEX"):
+    tb = archive / "ctrl" / f"{name}.tar.xz"
+    tb.write_bytes(b"x" * (list(_TARBALLS).index(name) + 1))
+    Path(f"{tb}.md5").write_text(f"0 {tb.name}\n")
+    Dataset(owner="drb", controller="ctrl", name=name, state=States.UNPACKED).add()
+    link = archive / "ctrl" / linksrc / tb.name
+    link.symlink_to(tb)
+    return link
+
+
+def _run(
+    tmp_path, server_logger, workers, signal=None, single_pass=False, re_index=False
+):
+    """Index the tar balls with the given number of workers, returning the
+    resulting Dataset states, report files, and tar ball links.
+    """
+    archive = tmp_path / f"archive{workers}"
+    linksrc = "TO-RE-INDEX" if re_index else "TO-INDEX"
+    (archive / "ctrl" / linksrc).mkdir(parents=True)
+    tmpdir = tmp_path / f"tmp{workers}"
+    tmpdir.mkdir()
+    idxctx = Namespace(
+        logger=server_logger,
+        TS="run-1970-01-01T00:00:00-UTC",
+        workers=workers,
+        checkpoint_actions=0,
+        single_pass=single_pass,
+    )
+    options = Namespace(re_index=re_index, index_tool_data=False)
+    index = Index("test-index", options, idxctx, tmp_path, str(archive), tmp_path / "q")
+    for name in _TARBALLS:
+        if name != "boom-e":
+            _link(archive, name, linksrc)
+    sigquit, sighup = [False], [False]
+    if signal == "SIGHUP":
+        # The tar ball which appears while indexing is picked up once the
+        # list of tar balls is collected again.
+        _signals["fail-b"] = _Signal(sighup, lambda: _link(archive, "boom-e", linksrc))
+    else:
+        _link(archive, "boom-e", linksrc)
+        if signal == "SIGQUIT":
+            _signals["fail-b"] = _Signal(sigquit)
+
+    status, tarballs = index.collect_tb()
+    assert status == 0
+    tb_queue = IndexingQueue(tarballs, workers=workers)
+    process = index._process_tb_pool if workers > 1 else index._process_tb_serial
+    files = [tmpdir / f for f in ("indexed", "erred", "skipped")]
+    process(tb_queue, None, tmpdir, *files, sigquit, sighup, None)
+    assert not _signals
+
+    states = {}
+    for name in _TARBALLS:
+        ds = Dataset.attach(controller="ctrl", name=name)
+        states[name] = ds.state
+        Database.db_session.delete(ds)
+        Database.db_session.commit()
+    reports = {
+        f.name: sorted(Path(tb).name for tb in f.read_text().splitlines())
+        if f.exists()
+        else []
+        for f in files
+    }
+    links = sorted(
+        str(Path(dirpath, f).relative_to(archive))
+        for dirpath, _, fnames in os.walk(archive)
+        for f in fnames
+        if Path(dirpath, f).is_symlink()
+    )
+    return states, reports, links
+
+
+class TestProcessTarballs:
+    @staticmethod
+    @pytest.mark.parametrize("signal", [None, "SIGQUIT", "SIGHUP"])
+    def test_pool_matches_serial(db, tmp_path, server_logger, monkeypatch, signal):
+        monkeypatch.setattr(Index, "_index_tb", _index_tb)
+        monkeypatch.setattr(indexing_tarballs, "_pool_index_tb", _pool_index_tb)
+        monkeypatch.setattr(indexing_tarballs.multiprocessing, "Pool", _Pool)
+
+        serial = _run(tmp_path, server_logger, 1, signal)
+        pool = _run(tmp_path, server_logger, 2, signal)
+        assert pool == serial
+
+        states, reports, links = serial
+        if signal == "SIGQUIT":
+            # The tar balls in flight finish, no others are started.
+            assert states["ok-a"] == States.INDEXED
+            assert states["fail-b"] == States.QUARANTINED
+            assert states["ok-d"] == States.UNPACKED
+            assert reports["indexed"] == ["ok-a.tar.xz"]
+            assert "ctrl/TO-INDEX/ok-d.tar.xz" in links
+            return
+        assert states == {
+            "ok-a": States.INDEXED,
+            "fail-b": States.QUARANTINED,
+            "nometa-c": States.QUARANTINED,
+            "ok-d": States.INDEXED,
+            "boom-e": States.QUARANTINED,
+        }
+        assert reports == {
+            "indexed": ["ok-a.tar.xz", "ok-d.tar.xz"],
+            "erred": ["boom-e.tar.xz", "fail-b.tar.xz"],
+            "skipped": ["nometa-c.tar.xz"],
+        }
+        assert links == [
+            "ctrl/TO-INDEX-TOOL/ok-a.tar.xz",
+            "ctrl/TO-INDEX-TOOL/ok-d.tar.xz",
+            "ctrl/WONT-INDEX.1/fail-b.tar.xz",
+            "ctrl/WONT-INDEX.4/nometa-c.tar.xz",
+            "ctrl/WONT-INDEX/boom-e.tar.xz",
+        ]
+
+    @staticmethod
+    @pytest.mark.parametrize("re_index", [False, True])
+    def test_single_pass(db, tmp_path, server_logger, monkeypatch, re_index):
+        monkeypatch.setattr(Index, "_index_tb", _index_tb)
+
+        states, reports, links = _run(
+            tmp_path, server_logger, 1, single_pass=True, re_index=re_index
+        )
+        assert reports["indexed"] == ["ok-a.tar.xz", "ok-d.tar.xz"]
+        # The tar balls indexed are done, without a tool data pass to follow.
+        assert links == [
+            "ctrl/INDEXED/ok-a.tar.xz",
+            "ctrl/INDEXED/ok-d.tar.xz",
+            "ctrl/WONT-INDEX.1/fail-b.tar.xz",
+            "ctrl/WONT-INDEX.4/nometa-c.tar.xz",
+            "ctrl/WONT-INDEX/boom-e.tar.xz",
+        ]
+
+
+# Units of three documents each, indexed four documents at a time.
+_UNITS = [("1-iter", "sample1", "host", f"tool{i}") for i in range(6)]
+
+
+def _checkpointed(checkpoint, fail_segment=None):
+    """Index the units not done in the given checkpoint, failing one
+    document of the given segment, returning the documents sent and the
+    checkpoint recorded.
+    """
+    idxctx = Namespace(checkpoint_actions=4)
+    index = Index.__new__(Index)
+    recorded = ["unset"]
+    sent = []
+
+    def set_checkpoint(dataset, key, value):
+        recorded[0] = value
+
+    index._set_checkpoint = set_checkpoint
+
+    def actions():
+        for unit in _UNITS:
+            if checkpoint.is_done(unit):
+                continue
+            for doc in range(3):
+                yield (unit[3], doc)
+            checkpoint.unit_finished(unit)
+
+    def es_index(segment):
+        docs = list(segment)
+        failures = 1 if len(sent) == fail_segment else 0
+        sent.append(docs)
+        return (0, 1, len(docs) - failures, 0, failures, 0)
+
+    es_res = index._es_index_checkpointed(
+        idxctx, actions(), es_index, None, "key", checkpoint
+    )
+    return [d for docs in sent for d in docs], recorded[0], es_res
+
+
+class TestCheckpointed:
+    @staticmethod
+    def test_resume_after_failure():
+        sent, value, es_res = _checkpointed(IndexingCheckpoint(_UNITS), 1)
+        assert len(sent) == 18
+        assert es_res[4] == 1
+        # Only the first unit was finished when the first segment was
+        # acknowledged; the failed second segment leaves the checkpoint as
+        # it was, rather than removing it.
+        assert value == IndexingCheckpoint(_UNITS, value).encode(2048)
+        assert IndexingCheckpoint(_UNITS, value).done == {0}
+
+        # On resume, the units with documents in the failed segment, and
+        # those after it, are sent again.
+        sent, value, es_res = _checkpointed(IndexingCheckpoint(_UNITS, value))
+        assert sent == [(f"tool{i}", doc) for i in range(1, 6) for doc in range(3)]
+        assert es_res[4] == 0
+        assert value is None
@@ -0,0 +1,75 @@
+import io
+import json
+from argparse import Namespace
+from collections import Counter
+
+import pytest
+
+from pbench.server.indexer import _json_array_items, _NotJsonArray, ResultData
+
+_TEXT = (
+    ' [ {"a": [1, 2.5, -3e-2, 4E+5], "b": {"c": null, "d": "x,]y"}},\n'
+    '  12345, "s", true, [], {} ]\n'
+)
+
+
+class TestJsonArrayItems:
+    @staticmethod
+    def test_items():
+        expected = json.loads(_TEXT)
+        for block_size in (1, 2, 7, 4096):
+            items = list(_json_array_items(io.StringIO(_TEXT), block_size))
+            assert items == expected, f"block size {block_size}"
+        assert list(_json_array_items(io.StringIO("[]"), 1)) == []
+        assert list(_json_array_items(io.StringIO("[ 1 ]"), 1)) == [1]
+
+    @staticmethod
+    @pytest.mark.parametrize(
+        "text", ["", "[", "[1,]", "[1 2]", "[1] 2", '[{"a": }]', "[1", "[1,"]
+    )
+    def test_invalid(text):
+        with pytest.raises(ValueError):
+            list(_json_array_items(io.StringIO(text), 1))
+
+    @staticmethod
+    def test_not_array():
+        with pytest.raises(_NotJsonArray):
+            list(_json_array_items(io.StringIO(' {"a": 1}'), 1))
+        with pytest.raises(ValueError):
+            list(_json_array_items(io.StringIO('{"a": 1'), 1))
+
+
+def _result_data():
+    rd = ResultData.__new__(ResultData)
+    rd.logger = Namespace(warning=lambda *args: None)
+    rd.counters = Counter()
+    rd.ptb = Namespace(_tbctx="ctx")
+    return rd
+
+
+class TestStreamResultJson:
+    @staticmethod
+    def test_valid(tmp_path):
+        result_json = tmp_path / "result.json"
+        result_json.write_text(_TEXT)
+        rd = _result_data()
+        assert list(rd._stream_result_json(str(result_json))) == json.loads(_TEXT)
+        assert not rd.counters
+
+    @staticmethod
+    @pytest.mark.parametrize(
+        "text, counter",
+        [
+            ('[{"iteration_number": 1}, {"iteration_number": 2', "not_valid_json_file"),
+            ('[{"iteration_number": 1}] 2', "not_valid_json_file"),
+            ('{"iteration_number": 1}', None),
+        ],
+    )
+    def test_invalid(tmp_path, text, counter):
+        result_json = tmp_path / "result.json"
+        result_json.write_text(text)
+        rd = _result_data()
+        # None of the iterations of an invalid file are generated, not even
+        # those preceding the error.
+        assert list(rd._stream_result_json(str(result_json))) == []
+        assert rd.counters == (Counter({counter: 1}) if counter else Counter())
@@ -0,0 +1,137 @@
+import io
+import lzma
+import tarfile
+
+import pytest
+
+from pbench.server import indexer
+from pbench.server.index_benchmark import BenchmarkShape, make_tarball
+from pbench.server.indexer import PbenchTarBall
+from pbench.server.manifest import (
+    ManifestError,
+    TeeReader,
+    list_members,
+    load_manifest,
+    manifest_path,
+    write_manifest,
+)
+
+
+def _mk_tarball(tb_path):
+    with tarfile.open(tb_path, mode="w:xz") as tb:
+        for name, mtype, data in (
+            ("run", tarfile.DIRTYPE, None),
+            ("run/metadata.log", tarfile.REGTYPE, b"[pbench]\n"),
+            ("run/link", tarfile.SYMTYPE, None),
+        ):
+            ti = tarfile.TarInfo(name)
+            ti.type = mtype
+            ti.mtime = 1234567890
+            if mtype == tarfile.DIRTYPE:
+                ti.mode = 0o755
+            elif mtype == tarfile.SYMTYPE:
+                ti.linkname = "metadata.log"
+            else:
+                ti.mode = 0o644
+                ti.size = len(data)
+            tb.addfile(ti, io.BytesIO(data) if data else None)
+
+
+class TestManifest:
+    @staticmethod
+    def test_round_trip(tmp_path):
+        tb_path = tmp_path / "run.tar.xz"
+        _mk_tarball(tb_path)
+        manifest = tmp_path / "manifest"
+        write_manifest(tb_path, "abc", manifest)
+
+        members = load_manifest(manifest, "run.tar.xz", "abc")
+        with tarfile.open(tb_path) as tb:
+            expected = tb.getmembers()
+        assert [m.name for m in members] == [m.name for m in expected]
+        for m, e in zip(members, expected):
+            assert (m.type, m.size, m.mode, m.mtime, m.linkpath) == (
+                e.type,
+                e.size,
+                e.mode,
+                e.mtime,
+                e.linkpath,
+            )
+            assert (m.isfile(), m.isdir(), m.issym()) == (
+                e.isfile(),
+                e.isdir(),
+                e.issym(),
+            )
+
+    @staticmethod
+    def test_list_members(tmp_path):
+        tb_path = tmp_path / "run.tar.xz"
+        _mk_tarball(tb_path)
+        members = list_members(tb_path)
+        with tarfile.open(tb_path) as tb:
+            expected = tb.getmembers()
+        assert [
+            (m.name, m.type, m.size, m.mode, m.mtime, m.linkpath) for m in members
+        ] == [(e.name, e.type, e.size, e.mode, e.mtime, e.linkpath) for e in expected]
+
+    @staticmethod
+    def test_mismatch(tmp_path):
+        tb_path = tmp_path / "run.tar.xz"
+        _mk_tarball(tb_path)
+        manifest = tmp_path / "manifest"
+        write_manifest(tb_path, "abc", manifest)
+
+        with pytest.raises(ManifestError):
+            load_manifest(manifest, "run.tar.xz", "def")
+        with pytest.raises(ManifestError):
+            load_manifest(manifest, "other.tar.xz", "abc")
+
+    @staticmethod
+    def test_corrupt(tmp_path):
+        manifest = tmp_path / "manifest"
+        manifest.write_text("not json\n")
+        with pytest.raises(ManifestError):
+            load_manifest(manifest, "run.tar.xz", "abc")
+
+    @staticmethod
+    def test_stream(tmp_path):
+        tb_path = tmp_path / "run.tar.xz"
+        _mk_tarball(tb_path)
+        data = lzma.decompress(tb_path.read_bytes())
+        out = io.BytesIO()
+        tee = TeeReader(io.BytesIO(data), out)
+        write_manifest(tb_path, "abc", tmp_path / "manifest", fileobj=tee)
+        tee.drain()
+        # The stream is passed through as is, end-of-archive blocks included.
+        assert out.getvalue() == data
+
+        write_manifest(tb_path, "abc", tmp_path / "expected")
+        assert (tmp_path / "manifest").read_text() == (
+            tmp_path / "expected"
+        ).read_text()
+
+    @staticmethod
+    def test_indexer(idxctx, tmp_path, caplog, monkeypatch):
+        shape = BenchmarkShape(
+            iterations=1, samples=1, hosts=1, tools=1, columns=1, rows=1, files=2
+        )
+        tb_path, extracted_root = make_tarball(shape, str(tmp_path))
+        md5sum = open(f"{tb_path}.md5").read().split()[0]
+        write_manifest(tb_path, md5sum, manifest_path(tb_path))
+
+        def members(ptb):
+            return [(m.name, m.type, m.size, m.mtime) for m in ptb.members]
+
+        with tarfile.open(tb_path) as tb:
+            expected = [(m.name, m.type, m.size, m.mtime) for m in tb.getmembers()]
+        with monkeypatch.context() as m:
+            # The tar ball is not read when its manifest is used.
+            m.setattr(indexer, "list_members", None)
+            ptb = PbenchTarBall(idxctx, None, tb_path, str(tmp_path), extracted_root)
+        assert members(ptb) == expected
+
+        # A manifest recorded for another tar ball is ignored.
+        write_manifest(tb_path, "abc", manifest_path(tb_path))
+        ptb = PbenchTarBall(idxctx, None, tb_path, str(tmp_path), extracted_root)
+        assert members(ptb) == expected
+        assert caplog.messages[-1].startswith("Ignoring member manifest ")
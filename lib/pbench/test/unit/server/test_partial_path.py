@@ -0,0 +1,55 @@
+import os
+import tarfile
+
+import pytest
+
+from pbench.server.index_benchmark import BenchmarkShape, make_tarball
+from pbench.server.indexer import PbenchTarBall
+
+
+def _tarball(tmp_path, nested):
+    shape = BenchmarkShape(
+        iterations=2, samples=2, hosts=2, tools=2, columns=2, rows=2, files=3
+    )
+    tb_path, extracted_root = make_tarball(shape, str(tmp_path))
+    name = os.path.basename(tb_path)[: -len(".tar.xz")]
+    if nested:
+        # A copy of some of the tool data of the run, under the run itself.
+        tb_dir = os.path.join(extracted_root, name)
+        copy_dir = os.path.join(tb_dir, "sysinfo", name, "1-synthetic", "sample1")
+        os.makedirs(copy_dir)
+        with open(os.path.join(copy_dir, "copied.csv"), "w") as fp:
+            print("timestamp_ms,value", file=fp)
+        with tarfile.open(tb_path, "w:xz") as tb:
+            tb.add(tb_dir, arcname=name)
+    return tb_path, extracted_root, name
+
+
+class TestPartialPath:
+    @staticmethod
+    @pytest.mark.parametrize("nested", [False, True])
+    def test_matches_scan(idxctx, tmp_path, nested):
+        tb_path, extracted_root, name = _tarball(tmp_path, nested)
+        ptb = PbenchTarBall(idxctx, None, tb_path, str(tmp_path), extracted_root)
+        host_dir = f"{name}/1-synthetic/sample1/tools-default/host0.example.com"
+        paths = [
+            f"{host_dir}/iostat/csv",
+            f"{host_dir}/iostat/json",
+            f"{host_dir}/iostat/iostat-stdout.txt",
+            f"{name}/1-synthetic/sample1",
+            f"{name}/1-synth",
+            f"{name}/sysinfo",
+            f"{name}/no-such-dir",
+            f"{name}/",
+            "1-synthetic/sample1",
+            "csv",
+        ]
+        for path in paths:
+            # The original scan of all the members of the tar ball.
+            expected = [
+                m.name for m in ptb.members if m.isfile() and m.name.find(path) >= 0
+            ]
+            assert list(ptb.gen_files_by_partial_path(path)) == expected, path
+        nested_name = f"{name}/sysinfo/{name}/1-synthetic/sample1/copied.csv"
+        found = list(ptb.gen_files_by_partial_path(f"{name}/1-synthetic/sample1"))
+        assert (nested_name in found) == nested
@@ -1,10 +1,14 @@
+import datetime
+import os
 import socket
+import time
 from pathlib import Path
 
 import pytest
 from werkzeug.utils import secure_filename
 
-from pbench.server.database.models.tracker import Dataset, States
+from pbench.server.api.resources.upload_api import UploadSession
+from pbench.server.database.models.tracker import Dataset, DatasetNotFound, States
 from pbench.test.unit.server.test_user_auth import login_user, register_user
 
 
@@ -276,3 +280,260 @@ class TestUpload:
 
             for record in caplog.records:
                 assert record.levelname not in ("WARNING", "ERROR", "CRITICAL")
+
+
+class TestUploadSession:
+    @staticmethod
+    def test_resumable_upload(client, pytestconfig, caplog, server_config):
+        with client:
+            auth_token = get_pbench_token(client, server_config)
+
+            filename = "log.tar.xz"
+            datafile = Path("./lib/pbench/test/unit/server/fixtures/upload/", filename)
+            controller = "resumable-upload"
+            with open(f"{datafile}.md5") as md5sum_check:
+                md5sum = md5sum_check.read()
+            data = datafile.read_bytes()
+            total = len(data)
+            half = total // 2
+            uri = f"{server_config.rest_uri}/upload/session/{controller}"
+            auth = {"Authorization": "Bearer " + auth_token}
+
+            response = client.post(
+                uri, headers={**auth, "filename": filename, "Content-MD5": md5sum},
+            )
+            assert response.status_code == 201, repr(response)
+            uri = f"{uri}/{response.json['session_id']}"
+            dataset = Dataset.attach(controller=controller, path=filename)
+            assert dataset.state == States.UPLOADING
+
+            response = client.put(
+                uri,
+                data=data[:half],
+                headers={**auth, "Content-Range": f"bytes 0-{half - 1}/{total}"},
+            )
+            assert response.status_code == 200
+            assert response.json["offset"] == half
+
+            response = client.get(uri, headers=auth)
+            assert response.status_code == 200
+            assert response.json == {"filename": filename, "offset": half}
+
+            # A chunk not starting at the committed offset is refused.
+            response = client.put(
+                uri,
+                data=data[1:half],
+                headers={**auth, "Content-Range": f"bytes 1-{half - 1}/{total}"},
+            )
+            assert response.status_code == 409
+            assert response.json["offset"] == half
+
+            response = client.put(
+                uri,
+                data=data[half:],
+                headers={
+                    **auth,
+                    "Content-Range": f"bytes {half}-{total - 1}/{total}",
+                },
+            )
+            assert response.status_code == 200
+            assert response.json["offset"] == total
+            dataset = Dataset.attach(controller=controller, path=filename)
+            assert dataset.state == States.UPLOADING
+
+            response = client.post(uri, headers=auth)
+            assert response.status_code == 201, repr(response)
+            tmp_d = pytestconfig.cache.get("TMP", None)
+            receive_dir = Path(
+                tmp_d, "srv", "pbench", "pbench-move-results-receive", "fs-version-002"
+            )
+            assert (receive_dir / controller / filename).read_bytes() == data
+            assert (receive_dir / controller / f"{filename}.md5").exists()
+            dataset = Dataset.attach(controller=controller, path=filename)
+            assert dataset.state == States.UPLOADED
+
+            response = client.get(uri, headers=auth)
+            assert response.status_code == 404
+
+            for record in caplog.records:
+                assert record.levelname not in ("WARNING", "ERROR", "CRITICAL")
+
+    @staticmethod
+    def test_upload_parts(client, pytestconfig, caplog, server_config):
+        with client:
+            auth_token = get_pbench_token(client, server_config)
+
+            filename = "log.tar.xz"
+            datafile = Path("./lib/pbench/test/unit/server/fixtures/upload/", filename)
+            controller = "upload-parts"
+            with open(f"{datafile}.md5") as md5sum_check:
+                md5sum = md5sum_check.read()
+            data = datafile.read_bytes()
+            total = len(data)
+            bounds = [0, total // 3, 2 * total // 3, total]
+            uri = f"{server_config.rest_uri}/upload/session/{controller}"
+            auth = {"Authorization": "Bearer " + auth_token}
+
+            response = client.post(
+                uri, headers={**auth, "filename": filename, "Content-MD5": md5sum},
+            )
+            assert response.status_code == 201, repr(response)
+            uri = f"{uri}/{response.json['session_id']}"
+
+            # The parts may arrive in any order; the last one is missing.
+            for first, stop in ((bounds[1], bounds[2]), (bounds[0], bounds[1])):
+                response = client.put(
+                    f"{uri}/part",
+                    data=data[first:stop],
+                    headers={
+                        **auth,
+                        "Content-Range": f"bytes {first}-{stop - 1}/{total}",
+                    },
+                )
+                assert response.status_code == 200
+            response = client.post(uri, headers=auth)
+            assert response.status_code == 400
+
+            response = client.put(
+                f"{uri}/part",
+                data=data[bounds[2] :],
+                headers={
+                    **auth,
+                    "Content-Range": f"bytes {bounds[2]}-{total - 1}/{total}",
+                },
+            )
+            assert response.status_code == 200
+            response = client.get(uri, headers=auth)
+            assert response.json["parts"] == [
+                [bounds[0], bounds[1]],
+                [bounds[1], bounds[2]],
+                [bounds[2], total],
+            ]
+
+            response = client.post(uri, headers=auth)
+            assert response.status_code == 201, repr(response)
+            tmp_d = pytestconfig.cache.get("TMP", None)
+            receive_dir = Path(
+                tmp_d, "srv", "pbench", "pbench-move-results-receive", "fs-version-002"
+            )
+            assert (receive_dir / controller / filename).read_bytes() == data
+            dataset = Dataset.attach(controller=controller, path=filename)
+            assert dataset.state == States.UPLOADED
+
+    @staticmethod
+    def test_commit_retry(client, pytestconfig, monkeypatch, server_config):
+        with client:
+            auth_token = get_pbench_token(client, server_config)
+
+            filename = "log.tar.xz"
+            datafile = Path("./lib/pbench/test/unit/server/fixtures/upload/", filename)
+            controller = "commit-retry"
+            with open(f"{datafile}.md5") as md5sum_check:
+                md5sum = md5sum_check.read()
+            data = datafile.read_bytes()
+            total = len(data)
+            uri = f"{server_config.rest_uri}/upload/session/{controller}"
+            auth = {"Authorization": "Bearer " + auth_token}
+            headers = {**auth, "filename": filename, "Content-MD5": md5sum}
+
+            response = client.post(uri, headers=headers)
+            assert response.status_code == 201, repr(response)
+            session_id = response.json["session_id"]
+
+            # Starting the same upload again resumes the session.
+            response = client.post(uri, headers=headers)
+            assert response.status_code == 200, repr(response)
+            assert response.json["session_id"] == session_id
+            response = client.post(uri, headers={**headers, "Content-MD5": "x"})
+            assert response.status_code == 200, repr(response)
+            assert "session_id" not in response.json
+            assert response.json["state"] == "UPLOADING"
+
+            uri = f"{uri}/{session_id}"
+            response = client.put(
+                uri,
+                data=data,
+                headers={**auth, "Content-Range": f"bytes 0-{total - 1}/{total}"},
+            )
+            assert response.status_code == 200
+
+            def fail(*args):
+                raise RuntimeError("database unavailable")
+
+            # The commit fails once the tar ball is linked into place.
+            with monkeypatch.context() as m:
+                m.setattr(UploadSession, "_finish", fail)
+                response = client.post(uri, headers=auth)
+            assert response.status_code == 500
+            tmp_d = pytestconfig.cache.get("TMP", None)
+            receive_dir = Path(
+                tmp_d, "srv", "pbench", "pbench-move-results-receive", "fs-version-002"
+            )
+            dataset = Dataset.attach(controller=controller, path=filename)
+            assert dataset.state == States.UPLOADING
+
+            # Retrying it only finishes the dataset.
+            monkeypatch.setattr(UploadSession, "_link_into_place", fail)
+            response = client.post(uri, headers=auth)
+            assert response.status_code == 201, repr(response)
+            assert (receive_dir / controller / filename).read_bytes() == data
+            assert (receive_dir / controller / f"{filename}.md5").exists()
+            dataset = Dataset.attach(controller=controller, path=filename)
+            assert dataset.state == States.UPLOADED
+
+            # The client can tell the tar ball was uploaded.
+            response = client.post(uri.rsplit("/", 1)[0], headers=headers)
+            assert response.status_code == 200, repr(response)
+            assert response.json["state"] == "UPLOADED"
+
+    @staticmethod
+    def test_expire(client, pytestconfig, monkeypatch, server_config):
+        with client:
+            auth_token = get_pbench_token(client, server_config)
+            server_config.conf.set("pbench-server", "upload-session-max-days", "1")
+
+            filename = "log.tar.xz"
+            datafile = Path("./lib/pbench/test/unit/server/fixtures/upload/", filename)
+            with open(f"{datafile}.md5") as md5sum_check:
+                md5sum = md5sum_check.read()
+            uri = f"{server_config.rest_uri}/upload/session"
+            headers = {
+                "Authorization": "Bearer " + auth_token,
+                "filename": filename,
+                "Content-MD5": md5sum,
+            }
+
+            response = client.post(f"{uri}/abandoned", headers=headers)
+            assert response.status_code == 201, repr(response)
+            tmp_d = pytestconfig.cache.get("TMP", None)
+            session_dir = Path(
+                tmp_d,
+                "srv",
+                "pbench",
+                "pbench-move-results-receive",
+                "fs-version-002",
+                UploadSession.sessions_dir_name,
+                response.json["session_id"],
+            )
+            two_days_ago = time.time() - 2 * 24 * 60 * 60
+            for path in (*session_dir.iterdir(), session_dir):
+                os.utime(path, (two_days_ago, two_days_ago))
+
+            # An interrupted plain upload.
+            interrupted = Dataset(
+                owner="user", controller="interrupted", path=filename, md5=md5sum
+            )
+            interrupted.add()
+            interrupted.transition = datetime.datetime.fromtimestamp(two_days_ago)
+            interrupted.update()
+
+            # Starting a session removes the abandoned ones, and their datasets.
+            monkeypatch.setattr(UploadSession, "_last_expiry", 0.0)
+            response = client.post(f"{uri}/fresh", headers=headers)
+            assert response.status_code == 201, repr(response)
+            assert not session_dir.exists()
+            for controller in ("abandoned", "interrupted"):
+                with pytest.raises(DatasetNotFound):
+                    Dataset.attach(controller=controller, path=filename)
+            dataset = Dataset.attach(controller="fresh", path=filename)
+            assert dataset.state == States.UPLOADING
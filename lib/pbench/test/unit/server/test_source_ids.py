@@ -0,0 +1,99 @@
+import hashlib
+import json
+from argparse import Namespace
+
+import pytest
+
+from pbench.server.index_benchmark import BenchmarkShape, make_tarball
+from pbench.server.indexer import (
+    FastSourceIds,
+    LegacySourceIds,
+    PbenchTarBall,
+    SourceEncoder,
+)
+
+
+def _td(preencoded_bodies=False):
+    return Namespace(
+        idxctx=Namespace(preencoded_bodies=preencoded_bodies),
+        run_metadata={
+            "id": "0123abcd",
+            "name": "fio_run",
+            "controller": "ctrl.example.com",
+            "start": "2020-02-03T04:00:00.000000",
+        },
+        iteration_metadata={"name": "1-read-4KiB", "number": 1},
+        sample_metadata={"name": "sample1", "hostname": "host0.example.com", "@idx": 0},
+    )
+
+
+def _source(td):
+    return {
+        "@timestamp": "2020-02-03T04:05:06.789000",
+        "@timestamp_original": "1580702706789",
+        "run": td.run_metadata,
+        "iteration": td.iteration_metadata,
+        "sample": td.sample_metadata,
+        "iostat": {"disk": "sda", "read": 12.5, "write": 0, "ünicode": "é"},
+    }
+
+
+class TestSourceIds:
+    @staticmethod
+    @pytest.mark.parametrize("preencoded_bodies", [False, True])
+    def test_legacy(preencoded_bodies):
+        td = _td(preencoded_bodies)
+        source_id = LegacySourceIds(td).source_id(_source(td))
+        # The ID the indexer has always given this document.
+        assert source_id == "522c723a972805e266f9f1789b344ba4"
+        encoded = getattr(source_id, "encoded", None)
+        if preencoded_bodies:
+            assert encoded == json.dumps(_source(td), separators=(",", ":"))
+        else:
+            assert encoded is None
+
+    @staticmethod
+    def test_fast():
+        td = _td()
+        source_id = FastSourceIds(td).source_id(_source(td))
+        encoded = json.dumps(_source(td), separators=(",", ":"))
+        assert source_id.encoded == encoded
+        assert source_id == hashlib.md5(encoded.encode("utf-8")).hexdigest()
+        # The same document gets the same ID from another ToolData object.
+        td = _td()
+        assert FastSourceIds(td).source_id(_source(td)) == source_id
+
+    @staticmethod
+    def test_encoder():
+        td = _td()
+        td.run_metadata["toc-prefix"] = {"nested": {"list": [1, "two", None]}}
+        encoder = SourceEncoder(td)
+        for i in range(3):
+            # Documents sharing the metadata objects, along with a copy of
+            # the run metadata, equal but not shared, which is encoded anew.
+            source = _source(td)
+            source["iostat"]["read"] = i * 0.5
+            source["copy"] = dict(td.run_metadata, id=str(i))
+            assert encoder.encode(source) == json.dumps(source, separators=(",", ":"))
+
+    @staticmethod
+    def test_spliced_bodies(idxctx, tmp_path):
+        shape = BenchmarkShape(
+            iterations=2, samples=2, hosts=2, tools=3, columns=2, rows=3
+        )
+        tb_path, extracted_root = make_tarball(shape, str(tmp_path))
+
+        def actions(preencoded_bodies):
+            idxctx.preencoded_bodies = preencoded_bodies
+            ptb = PbenchTarBall(idxctx, None, tb_path, str(tmp_path), extracted_root)
+            return list(ptb.mk_tool_data_actions())
+
+        expected = actions(False)
+        spliced = actions(True)
+        assert len(spliced) == len(expected) > 0
+        for action, exp in zip(spliced, expected):
+            assert isinstance(action["_source"], str)
+            assert action["_source"] == json.dumps(
+                exp["_source"], separators=(",", ":")
+            )
+            assert (action["_index"], action["_id"]) == (exp["_index"], exp["_id"])
@@ -0,0 +1,314 @@
+import functools
+import io
+import json
+from argparse import Namespace
+
+import pytest
+
+from pbench.server import indexer
+from pbench.server.indexer import (
+    _dict_const,
+    _stdout_lines,
+    _stdout_records,
+    ToolData,
+)
+
+_TEXT = (
+    "preamble line\n"
+    "timestamp: 1001.5\n"
+    "a 1\n"
+    "b_x 2\n"
+    "timestamp: 1002.5\n"
+    "timestamp: 1003.5 extra\n"
+    "a 3\n"
+    "b_x 4"
+)
+
+
+def _baseline_stdout_keyval(self, file_object, converter, path):
+    """The original line at a time processing of a keyval stdout file."""
+    record = None
+    prev_gauge = None
+    ts_orig = None
+    prev_ts_orig = None
+    try:
+        remaps = self._remaps[self.toolname]
+    except KeyError:
+        remaps = None
+    idx = 0
+    for line in file_object:
+        if line.startswith("timestamp:"):
+            prev_ts_orig = ts_orig
+            if record:
+                if not record[self.toolname]["rate"]:
+                    del record[self.toolname]["rate"]
+                yield record
+                idx += 1
+                prev_gauge = record[self.toolname]["gauge"]
+            ts_orig = float(line.split(":")[1])
+            ts_str = self.mk_abs_timestamp_millis(ts_orig * 1000)
+            record = _dict_const()
+            record["@timestamp"] = ts_str
+            record["@timestamp_original"] = str(ts_orig)
+            record["run"] = self.run_metadata
+            record["iteration"] = self.iteration_metadata
+            record["sample"] = self.sample_metadata
+            record[self.toolname] = _dict_const()
+            record[self.toolname]["@idx"] = idx
+            record[self.toolname]["gauge"] = gauge = _dict_const()
+            record[self.toolname]["rate"] = rate = _dict_const()
+        elif ts_orig is None:
+            continue
+        else:
+            key, value = line.strip().split(" ")
+            parts = key.split("_", 1)
+            if len(parts) == 1:
+                if remaps is not None:
+                    try:
+                        stat = remaps["key"][key]
+                    except KeyError:
+                        stat = key
+                else:
+                    stat = key
+                gauge[stat] = converter(value)
+                if prev_ts_orig:
+                    duration = ts_orig - prev_ts_orig
+                    value_diff = int(value) - prev_gauge[stat]
+                    rate[stat] = value_diff / duration
+            else:
+                stat = parts[0]
+                substat = parts[1]
+                if stat not in gauge:
+                    gauge[stat] = _dict_const()
+                gauge[stat][substat] = converter(value)
+                if prev_ts_orig:
+                    duration = (ts_orig / 1000) - (prev_ts_orig / 1000)
+                    value_diff = int(value) - prev_gauge[stat][substat]
+                    if stat not in rate:
+                        rate[stat] = _dict_const()
+                    rate[stat][substat] = value_diff / duration
+    if record and record[self.toolname]["gauge"]:
+        yield record
+
+
+def _baseline_stdout_procint(self, file_object, converter, path):
+    """The original line at a time processing of a procint stdout file."""
+    cpu_column_ids = None
+    cpu_count = None
+    ts_str = None
+    ts_orig = None
+    prev_ts_orig = None
+    prev_gauges = _dict_const()
+    idx = 0
+    for line in file_object:
+        if line.startswith("timestamp:"):
+            idx += 1
+            prev_ts_orig = ts_orig
+            ts_orig = float(line.split(":")[1])
+            ts_str = self.mk_abs_timestamp_millis(ts_orig * 1000)
+            header = next(file_object)
+            columns = header.split()
+            cpu_column_ids = []
+            for cpu in columns:
+                if not cpu.startswith("CPU"):
+                    raise Exception("Bad proc-interrupts-stdout.txt file encountered")
+                cpu_column_ids.append(cpu[3:])
+            cpu_count = len(cpu_column_ids)
+            continue
+        parts = line[:-1].split(None, 1 + cpu_count)
+        int_id = parts[0][:-1]
+        if int_id in ("ERR", "MIS"):
+            record = _dict_const()
+            record["@timestamp"] = ts_str
+            record["@timestamp_original"] = str(ts_orig)
+            record["run"] = self.run_metadata
+            record["iteration"] = self.iteration_metadata
+            record["sample"] = self.sample_metadata
+            record[self.toolname] = _dict_const()
+            record[self.toolname]["@idx"] = idx
+            record[self.toolname]["int_id"] = int_id
+            record[self.toolname]["gauge"] = value = converter(parts[1])
+            if int_id in prev_gauges:
+                duration = ts_orig - prev_ts_orig
+                record[self.toolname]["rate"] = (value - prev_gauges[int_id]) / duration
+            prev_gauges[int_id] = value
+            yield record
+        else:
+            desc_str = parts[-1]
+            col = 1
+            records = []
+            cpu_gauges = []
+            for cpu in cpu_column_ids:
+                val = converter(parts[col])
+                col += 1
+                record = _dict_const()
+                record["@timestamp"] = ts_str
+                record["@timestamp_original"] = str(ts_orig)
+                record["run"] = self.run_metadata
+                record["iteration"] = self.iteration_metadata
+                record["sample"] = self.sample_metadata
+                record[self.toolname] = _dict_const()
+                record[self.toolname]["@idx"] = idx
+                record[self.toolname]["int_id"] = int_id
+                record[self.toolname]["cpu_id"] = cpu
+                record[self.toolname]["desc"] = desc_str
+                record[self.toolname]["gauge"] = val
+                records.append(record)
+                cpu_gauges.append(val)
+            if int_id in prev_gauges:
+                prev_cpu_gauges = prev_gauges[int_id]
+                col = 0
+                duration = ts_orig - prev_ts_orig
+                for record in records:
+                    value_diff = record[self.toolname]["gauge"] - prev_cpu_gauges[col]
+                    record[self.toolname]["rate"] = value_diff / duration
+            prev_gauges[int_id] = cpu_gauges
+            for record in records:
+                yield record
+
+
+# Records of proc-vmstat, with remapped keys ("allocstall", "pgrefill")
+# alongside sub-stats of the same name, and records with repeated keys, or
+# keys in a different order or missing, which are processed a line at a
+# time rather than using the layout of the previous record.
+_VMSTAT_RECORDS = [
+    "nr_free_pages {0}\nnr_zone_inactive_anon {1}\nallocstall {2}\n"
+    "allocstall_dma {3}\npgrefill {4}\npgfault {5}\nnr_dirty {6}\n",
+    "nr_free_pages {0}\nnr_zone_inactive_anon {1}\nallocstall {2}\n"
+    "allocstall_dma {3}\npgrefill {4}\npgfault {5}\nnr_dirty {6}\n",
+    # Repeated stat, twice, so that the rates of the second are computed
+    # against the last value of the stat in the first.
+    "nr_free_pages {0}\nnr_zone_inactive_anon {1}\nallocstall {2}\n"
+    "allocstall_dma {3}\npgrefill {4}\npgfault {5}\nnr_dirty {6}\npgfault {3}\n",
+    "nr_free_pages {0}\nnr_zone_inactive_anon {1}\nallocstall {2}\n"
+    "allocstall_dma {3}\npgrefill {4}\npgfault {5}\nnr_dirty {6}\npgfault {3}\n",
+    "nr_free_pages {0}\nnr_zone_inactive_anon {1}\nallocstall {2}\n"
+    "allocstall_dma {3}\npgrefill {4}\npgfault {5}\nnr_dirty {6}\n",
+    # Repeated sub-stat.
+    "nr_free_pages {0}\nnr_zone_inactive_anon {1}\nallocstall {2}\n"
+    "allocstall_dma {3}\npgrefill {4}\nnr_free_pages {2}\npgfault {5}\n"
+    "nr_dirty {6}\n",
+    # Different order, and a missing key.
+    "pgfault {5}\nnr_dirty {6}\nallocstall {2}\nnr_free_pages {0}\n"
+    "allocstall_dma {3}\npgrefill {4}\n",
+    "pgfault {5}\nnr_dirty {6}\nallocstall {2}\nnr_free_pages {0}\n"
+    "allocstall_dma {3}\npgrefill {4}\n",
+    "nr_free_pages {0}\npgfault {5}\nnr_dirty {6}\nallocstall {2}\n"
+    "allocstall_dma {3}\npgrefill {4}\n",
+]
+
+
+def _vmstat_text():
+    text = ["some preamble\n"]
+    for i, record in enumerate(_VMSTAT_RECORDS):
+        text.append(f"timestamp: {1600000000 + 1.25 * i}\n")
+        text.append(record.format(*(1000 * v + 7 * i * v for v in range(1, 8))))
+    # A last record without any key/value pairs is not emitted.
+    return "".join(text) + "timestamp: 1600000020.0\n"
+
+
+def _procint_text():
+    text = []
+    for i in range(4):
+        text.append(f"timestamp: {1600000000 + 0.5 * i}\n")
+        text.append("           CPU0       CPU1       CPU2\n")
+        text.append(f"  0:   {25 + i}   {i}   {3 * i}   IO-APIC-edge      timer\n")
+        text.append(f"NMI:   {i}   0   {i * i}   Non-maskable interrupts\n")
+        text.append(f"LOC:   {48687 + 100 * i}   {45068 + i}   {7}   Local timer\n")
+        text.append(f"ERR:   {i}\n")
+        text.append(f"MIS:   {2 * i}\n")
+    return "".join(text)[:-1]
+
+
+def _tool_data(toolname):
+    td = ToolData.__new__(ToolData)
+    td.toolname = toolname
+    td.logger = Namespace(info=lambda *args: None)
+    td.run_metadata = {"id": "run-id"}
+    td.iteration_metadata = {"name": "1-iter"}
+    td.sample_metadata = {"name": "sample1"}
+    td.mk_abs_timestamp_millis = lambda ts: f"ts-{ts!r}"
+    return td
+
+
+def _records(func, td, text, converter):
+    records = []
+    try:
+        for record in func(td, io.StringIO(text), converter, "path"):
+            records.append(json.dumps(record))
+    except Exception as e:
+        records.append(repr(e))
+    return records
+
+
+class TestStdoutRecords:
+    @staticmethod
+    def test_records():
+        expected = [
+            (None, "preamble line\n"),
+            (" 1001.5", "a 1\nb_x 2\n"),
+            (" 1002.5", ""),
+            (" 1003.5 extra", "a 3\nb_x 4"),
+        ]
+        for block_size in (1, 5, 17, 4096):
+            records = list(_stdout_records(io.StringIO(_TEXT), block_size))
+            assert records == expected, f"block size {block_size}"
+        assert list(_stdout_records(io.StringIO(""))) == []
+        assert list(_stdout_records(io.StringIO("timestamp: 1\n"))) == [(" 1", "")]
+
+    @staticmethod
+    def test_lines():
+        assert _stdout_lines("a 1\nb_x 2\n") == ["a 1", "b_x 2"]
+        assert _stdout_lines("a 3\nb_x 4") == ["a 3", "b_x 4"]
+        assert _stdout_lines("") == []
+
+
+class TestStdoutSubformats:
+    @staticmethod
+    @pytest.mark.parametrize("block_size", [16, 100, None])
+    @pytest.mark.parametrize("toolname", ["proc-vmstat", "other-vmstat"])
+    def test_keyval(monkeypatch, block_size, toolname):
+        if block_size is not None:
+            monkeypatch.setattr(
+                indexer,
+                "_stdout_records",
+                functools.partial(_stdout_records, block_size=block_size),
+            )
+        td = _tool_data(toolname)
+        text = _vmstat_text()
+        expected = _records(_baseline_stdout_keyval, td, text, int)
+        if toolname == "proc-vmstat":
+            assert len(expected) == len(_VMSTAT_RECORDS)
+            assert all(record.startswith("{") for record in expected)
+            assert '"allocstall_": 3000' in expected[0]
+        else:
+            # Without remapping, the "allocstall" stat conflicts with the
+            # "allocstall_dma" sub-stat.
+            assert expected == [
+                repr(TypeError("'int' object does not support item assignment"))
+            ]
+        assert _records(ToolData._stdout_keyval, td, text, int) == expected
+
+    @staticmethod
+    def test_keyval_bad_value():
+        td = _tool_data("proc-vmstat")
+        # The "pgfault" value of the fourth record.
+        text = _vmstat_text().replace(f"pgfault {6000 + 7 * 3 * 6}", "pgfault x")
+        expected = _records(_baseline_stdout_keyval, td, text, int)
+        assert expected[-1].startswith("ValueError")
+        assert _records(ToolData._stdout_keyval, td, text, int) == expected
+
+    @staticmethod
+    @pytest.mark.parametrize("block_size", [16, 100, None])
+    def test_procint(monkeypatch, block_size):
+        if block_size is not None:
+            monkeypatch.setattr(
+                indexer,
+                "_stdout_records",
+                functools.partial(_stdout_records, block_size=block_size),
+            )
+        td = _tool_data("proc-interrupts")
+        text = _procint_text()
+        expected = _records(_baseline_stdout_procint, td, text, int)
+        assert len(expected) == 4 * (3 * 3 + 2)
+        assert _records(ToolData._stdout_procint, td, text, int) == expected
@@ -0,0 +1,77 @@
+import os
+
+import pyesbulk
+
+from pbench.server.templates import PbenchTemplates
+
+_BINDIR = os.path.abspath("./server/bin")
+
+
+class _Indices:
+    def __init__(self, installed):
+        self.installed = installed
+
+    def get_template(self, name, ignore=None):
+        assert name == "unit-test.*" and ignore == 404
+        return self.installed
+
+
+class _Es:
+    def __init__(self, installed):
+        self.indices = _Indices(installed)
+
+
+def _installed(templates, skip=None):
+    return {
+        name: {"mappings": {"_meta": dict(body["mappings"]["_meta"])}}
+        for name, body in templates.templates.items()
+        if name != skip
+    }
+
+
+class TestTemplatesCache:
+    @staticmethod
+    def test_cache(tmp_path, monkeypatch, server_logger):
+        templates = PbenchTemplates(_BINDIR, "unit-test", server_logger)
+        cached = PbenchTemplates(
+            _BINDIR, "unit-test", server_logger, cache_dir=str(tmp_path)
+        )
+        assert cached.templates == templates.templates
+        assert (tmp_path / PbenchTemplates._cache_name).exists()
+
+        def _no_load(json_fn):
+            raise AssertionError(f"unexpected load of {json_fn}")
+
+        monkeypatch.setattr(PbenchTemplates, "_load_json", staticmethod(_no_load))
+        reloaded = PbenchTemplates(
+            _BINDIR, "unit-test", server_logger, cache_dir=str(tmp_path)
+        )
+        assert reloaded.templates == templates.templates
+        assert reloaded.versions == templates.versions
+
+    @staticmethod
+    def test_update_unchanged(monkeypatch, server_logger, caplog):
+        pushed = []
+
+        def put_template(es, name, mapping_name, body):
+            pushed.append(name)
+            return 1.0, 2.0, 0, "ok"
+
+        monkeypatch.setattr(pyesbulk, "put_template", put_template)
+        templates = PbenchTemplates(_BINDIR, "unit-test", server_logger)
+        names = sorted(templates.templates)
+        stale = names[0]
+        installed = _installed(templates, skip=stale)
+        templates.update_templates(_Es(installed))
+        assert pushed == [stale]
+
+        pushed.clear()
+        installed[stale] = {"mappings": {"_meta": {"version": -1}}}
+        templates.update_templates(_Es(installed))
+        assert pushed == [stale]
+
+        pushed.clear()
+        installed = _installed(templates)
+        templates.update_templates(_Es(installed))
+        assert pushed == []
+        assert caplog.messages[-1] == f"done templates (unchanged: {len(names)})"
@@ -0,0 +1,67 @@
+from pbench.server.indexer import PbenchData, ToolDataRollup
+
+
+class FakeToolData:
+    toolname = "iostat"
+    run_metadata = {"id": "run-id"}
+    iteration_metadata = {"name": "1-iter", "number": 1}
+    sample_metadata = {"name": "sample1", "hostname": "host"}
+    make_source_id = staticmethod(PbenchData.make_source_id)
+
+    @staticmethod
+    def generate_index_name(template_name, source, toolname=None):
+        return f"unit-test.v1.{template_name}-{toolname}.{source['@timestamp'][:7]}"
+
+
+def _source(ts, disk, read, write):
+    return {
+        "@timestamp": f"2021-01-01T00:{ts}.000000",
+        "iostat": {"@idx": 0, "id": disk, "iops": {"read": read, "write": write}},
+    }
+
+
+class TestToolDataRollup:
+    @staticmethod
+    def test_rollups():
+        rollup = ToolDataRollup(FakeToolData())
+        for i, ts in enumerate(("00:58", "00:59", "01:00", "01:01")):
+            rollup.add(_source(ts, "sda", float(i), 2 * i))
+        rollup.add(_source("00:59", "sdb", 7.0, 0))
+        sources = list(rollup.sources())
+        assert {idx for idx, _, _ in sources} == {
+            "unit-test.v1.tool-data-rollup-iostat.2021-01"
+        }
+        by_key = {
+            (
+                s["tool"]["id"],
+                s["tool"]["metric"],
+                s["rollup"]["window"],
+                s["@timestamp"],
+            ): s["rollup"]
+            for _, s, _ in sources
+        }
+        assert len(by_key) == len(sources) == 10
+        sample = by_key[("sda", "iops.read", "sample", "2021-01-01T00:00:58.000000")]
+        assert sample["end"] == "2021-01-01T00:01:01.000000"
+        assert (sample["count"], sample["min"], sample["max"]) == (4, 0.0, 3.0)
+        assert (sample["avg"], sample["p95"]) == (1.5, 3.0)
+        minute = by_key[("sda", "iops.write", "1m", "2021-01-01T00:01:00.000000")]
+        assert minute["end"] == "2021-01-01T00:02:00.000000"
+        assert (minute["count"], minute["min"], minute["max"]) == (2, 4.0, 6.0)
+        assert ("sdb", "iops.read", "1m", "2021-01-01T00:00:00.000000") in by_key
+
+    @staticmethod
+    def test_identifier():
+        class PrometheusData(FakeToolData):
+            toolname = "prometheus-metrics"
+
+        rollup = ToolDataRollup(PrometheusData())
+        rollup.add(
+            {
+                "@timestamp": "2021-01-01T00:00:00.000000",
+                "prometheus-metrics": {"metric": "m", "type": "GAUGE", "value": 1},
+            }
+        )
+        _, source, _ = next(rollup.sources())
+        assert source["tool"]["id"] == "metric=m,type=GAUGE"
+        assert source["tool"]["metric"] == "value"
@@ -0,0 +1,32 @@
+import json
+
+from pbench.server.index_benchmark import BenchmarkShape, make_tarball
+from pbench.server.indexer import PbenchTarBall
+
+
+def _tool_data_docs(idxctx, tb_path, root, extracted_root):
+    ptb = PbenchTarBall(idxctx, None, tb_path, root, extracted_root)
+    docs = set()
+    for action in ptb.mk_tool_data_actions():
+        source = action["_source"]
+        if isinstance(source, str):
+            source = json.loads(source)
+        docs.add((action["_index"], action["_id"], json.dumps(source, sort_keys=True)))
+    return docs
+
+
+class TestToolDataWorkers:
+    @staticmethod
+    def test_parallel_matches_serial(idxctx, tmp_path):
+        shape = BenchmarkShape(
+            iterations=2, samples=2, hosts=2, tools=3, columns=3, rows=20
+        )
+        tb_path, extracted_root = make_tarball(shape, str(tmp_path))
+
+        idxctx.tool_data_workers = 1
+        serial = _tool_data_docs(idxctx, tb_path, str(tmp_path), extracted_root)
+        idxctx.tool_data_workers = 3
+        parallel = _tool_data_docs(idxctx, tb_path, str(tmp_path), extracted_root)
+        # Every document has an ID of its own.
+        assert len(serial) == len({(idx, _id) for idx, _id, _ in serial}) > 0
+        assert parallel == serial
@@ -0,0 +1,112 @@
+import json
+import os
+
+import pytest
+
+from pbench.server import indexer
+from pbench.server.index_benchmark import BenchmarkShape, make_tarball
+from pbench.server.indexer import PbenchTarBall, _RowAtATime
+
+
+# The rows of the synthetic csv files span more than one block.
+_ROWS = indexer._CSV_BLOCK_ROWS + 100
+
+
+def _edit_csv(csv_dir, fname, edit):
+    path = os.path.join(csv_dir, fname)
+    with open(path) as fp:
+        lines = fp.read().splitlines()
+    with open(path, "w") as fp:
+        for line in edit(lines):
+            print(line, file=fp)
+
+
+def _edit_row(row, edit):
+    def _edit(lines):
+        lines[row + 1] = edit(lines[row + 1])
+        return lines
+
+    return _edit
+
+
+def _damage(extracted_root, name, damage):
+    tools_dir = os.path.join(
+        extracted_root,
+        name,
+        "1-synthetic",
+        "sample1",
+        "tools-default",
+        "host0.example.com",
+    )
+    iostat = os.path.join(tools_dir, "iostat", "csv")
+    vmstat = os.path.join(tools_dir, "vmstat", "csv")
+    row = indexer._CSV_BLOCK_ROWS + 10
+    if damage == "ragged":
+        # A row missing a value, in the second block.
+        _edit_csv(
+            iostat, "disk_IOPS.csv", _edit_row(row, lambda line: line.rsplit(",", 1)[0])
+        )
+    elif damage == "short":
+        # csv files with fewer rows than the others.
+        _edit_csv(iostat, "disk_Queue_Size.csv", lambda lines: lines[: row + 1])
+        _edit_csv(vmstat, "vmstat_procs.csv", lambda lines: lines[:500])
+    elif damage == "bad-value":
+        # A value that can't be converted.
+        _edit_csv(vmstat, "vmstat_memory.csv", _edit_row(row, lambda line: line + "x"))
+    elif damage == "bad-timestamp":
+        # A timestamp that isn't one, in all the csv files of a tool.
+        for fname in os.listdir(iostat):
+            _edit_csv(
+                iostat,
+                fname,
+                _edit_row(row, lambda line: "abc," + line.split(",", 1)[1]),
+            )
+
+
+def _events(idxctx, tb_path, root, extracted_root):
+    """Return the documents generated for each unit of tool data of the given
+    tar ball, along with any error raised, and the counters of the unit.
+    """
+    ptb = PbenchTarBall(idxctx, None, tb_path, root, extracted_root)
+    events = []
+    for td in ptb.mk_tool_data():
+        try:
+            for source, source_id in td.make_source() or ():
+                events.append((td.toolname, source_id, json.dumps(source)))
+        except Exception as e:
+            events.append((td.toolname, type(e).__name__, str(e)))
+        events.append((td.toolname, dict(td.counters)))
+    return events
+
+
+def _row_at_a_time(converter, values):
+    raise _RowAtATime()
+
+
+class TestUnifiedBlocks:
+    @staticmethod
+    @pytest.mark.parametrize(
+        "damage", [None, "ragged", "short", "bad-value", "bad-timestamp"]
+    )
+    def test_matches_row_at_a_time(idxctx, tmp_path, monkeypatch, damage):
+        shape = BenchmarkShape(
+            iterations=1, samples=1, hosts=1, tools=3, columns=2, rows=_ROWS
+        )
+        tb_path, extracted_root = make_tarball(shape, str(tmp_path))
+        name = os.path.basename(tb_path)[: -len(".tar.xz")]
+        _damage(extracted_root, name, damage)
+
+        blocks = _events(idxctx, tb_path, str(tmp_path), extracted_root)
+        # Process every block a row at a time, as all the rows used to be.
+        monkeypatch.setattr(indexer, "_convert_column", _row_at_a_time)
+        rows = _events(idxctx, tb_path, str(tmp_path), extracted_root)
+        assert blocks == rows
+
+        assert len(blocks) > _ROWS
+        errors = [e[1] for e in blocks if e[1] in ("ValueError", "BadDate")]
+        if damage == "bad-value":
+            assert errors == ["ValueError"]
+        elif damage == "bad-timestamp":
+            assert errors == ["BadDate"]
+        else:
+            assert not errors
@@ -0,0 +1,11 @@
+from pbench.server.upload_benchmark import run
+
+
+class TestUploadBenchmark:
+    @staticmethod
+    def test_run(tmp_path):
+        # Not a multiple of either loop's read size.
+        results = run(3 * 1024 * 1024 + 17, str(tmp_path))
+        assert [name for name, _, _ in results] == ["4 KiB reads", "large buffer"]
+        assert all(elapsed > 0 and rate > 0 for _, elapsed, rate in results)
+        assert list(tmp_path.iterdir()) == []
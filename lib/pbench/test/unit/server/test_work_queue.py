@@ -0,0 +1,92 @@
+import datetime
+
+import pytest
+
+from pbench.server import work_queue
+from pbench.server.database.database import Database
+from pbench.server.database.models.tracker import Dataset, States, WorkItem
+from pbench.server.work_queue import WorkQueue
+
+
+@pytest.fixture
+def db(tmp_path, server_config, server_logger):
+    # A database file of its own, so that the claiming session of the work
+    # queue has a connection of its own too.
+    server_config.conf.set("Postgres", "db_uri", f"sqlite:///{tmp_path}/tracker.db")
+    Database.init_db(server_config, server_logger)
+    yield Database.db_session
+    Database.db_session.remove()
+
+
+def _dataset(name, state):
+    ds = Dataset(owner="drb", controller="frodo", name=name, state=state)
+    ds.add()
+    return ds
+
+
+class TestWorkQueue:
+    @staticmethod
+    def test_claim_done(db, server_logger):
+        fio = _dataset("fio", States.UPLOADED)
+        uperf = _dataset("uperf", States.UPLOADED)
+        assert WorkQueue.enqueue(fio, server_logger)
+        assert WorkQueue.enqueue(uperf, server_logger)
+        # Queueing a dataset again for the same state is a no-op.
+        assert WorkQueue.enqueue(fio, server_logger)
+        assert db.query(WorkItem).count() == 2
+
+        unpackers = WorkQueue([States.UPLOADED], server_logger)
+        indexers = WorkQueue([States.UNPACKED], server_logger)
+        assert indexers.claim() is None
+
+        # The oldest item is claimed first, and handed to the next state
+        # when done.
+        item = unpackers.claim()
+        assert (item.dataset_ref, item.state) == (fio.id, States.UPLOADED)
+        unpackers.done(item, States.UNPACKED)
+        item = indexers.claim()
+        assert (item.dataset_ref, item.state) == (fio.id, States.UNPACKED)
+        indexers.done(item)
+        assert indexers.claim() is None
+
+        # A released item stays queued.
+        item = unpackers.claim()
+        assert item.dataset_ref == uperf.id
+        unpackers.release()
+        item = unpackers.claim()
+        assert item.dataset_ref == uperf.id
+        unpackers.done(item)
+        assert unpackers.claim() is None
+        db.expire_all()
+        assert db.query(WorkItem).count() == 0
+
+    @staticmethod
+    def test_retry(db, server_logger, caplog):
+        fio = _dataset("fio", States.UPLOADED)
+        assert WorkQueue.enqueue(fio, server_logger)
+        unpackers = WorkQueue([States.UPLOADED], server_logger)
+
+        def ready_now():
+            db.query(WorkItem).update({"ready": datetime.datetime.now()})
+            db.commit()
+
+        # A failed item is not claimed again until its retry delay elapsed,
+        # and is given up on after the maximum number of attempts.
+        for attempt in range(1, work_queue.MAX_ATTEMPTS):
+            item = unpackers.claim()
+            assert item.attempts == attempt - 1
+            assert unpackers.retry(item)
+            assert item.ready > datetime.datetime.now()
+            assert unpackers.claim() is None
+            ready_now()
+        assert not unpackers.retry(unpackers.claim())
+        assert unpackers.claim() is None
+        assert caplog.records[-1].levelname == "ERROR"
+
+    @staticmethod
+    def test_enabled(server_config, server_logger):
+        assert not WorkQueue.enabled(server_config, server_logger)
+        server_config.conf.set("pbench-server", "dataset-work-queue", "yes")
+        assert WorkQueue.enabled(server_config, server_logger)
+        server_config.conf.set("pbench-server", "dataset-work-queue", "maybe")
+        assert not WorkQueue.enabled(server_config, server_logger)
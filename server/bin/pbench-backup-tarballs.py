@@ -11,7 +11,6 @@ from pathlib import Path
 
 from pbench.common.exceptions import BadConfig
 from pbench.common.logger import get_pbench_logger
-from pbench.common.utils import md5sum
 from pbench.server import PbenchServerConfig
 from pbench.server.report import Report
 from pbench.server.s3backup import S3Config, Status, NoSuchKey
@@ -22,6 +21,7 @@ from pbench.server.database.models.tracker import (
     DatasetError,
 )
 from pbench.server.database.database import Database
+from pbench.server.fingerprint import Fingerprints
 
 
 _NAME_ = "pbench-backup-tarballs"
@@ -289,6 +289,7 @@ def backup_to_s3(
 def backup_data(lb_obj, s3_obj, config, logger):
     qdir = config.QDIR
 
+    fingerprints = Fingerprints(config, logger)
     tarlist = glob.iglob(os.path.join(config.ARCHIVE, "*", _linksrc, "*.tar.xz"))
     ntotal = nbackup_success = nbackup_fail = ns3_success = ns3_fail = nquaran = 0
 
@@ -341,9 +342,10 @@ def backup_data(lb_obj, s3_obj, config, logger):
             logger.exception("Quarantine: {}, Could not read {}", tb, archive_md5)
             continue
 
-        # match md5sum of the tarball to its md5 file
+        # match md5sum of the tarball to its md5 file, trusting its
+        # fingerprint if an earlier stage verified it
         try:
-            (_, archive_tar_hex_value) = md5sum(tar)
+            archive_tar_hex_value = fingerprints.md5(tar, archive_md5_hex_value)
         except Exception:
             # Could not read file.
             quarantine(qdir, logger, tb)
@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+# -*- mode: python -*-
+
+"""Pbench Dataset Worker
+
+Long-running worker claiming the datasets of the work queue as they are
+uploaded, unpacking and then indexing their tar balls (see
+pbench.server.dataset_worker).  Any number of workers can run at the same
+time, each claiming its own datasets; workers take turns at each stage with
+each other, and with its cron job, holding the lock of that cron job.
+
+Requires "dataset-work-queue = yes" in the "pbench-server" section of the
+configuration; idle workers check the queue every "dataset-worker-poll-seconds"
+seconds (default 30), or as soon as a dataset is queued on PostgreSQL.
+
+A SIGTERM or SIGINT stops the worker once done with the current dataset.
+
+Return 0 once stopped, and > 0 on any error.
+"""
+
+import os
+import signal
+import sys
+
+from pbench.common.exceptions import BadConfig
+from pbench.common.logger import get_pbench_logger
+from pbench.server import PbenchServerConfig
+from pbench.server.database.database import Database
+from pbench.server.dataset_worker import DatasetWorker
+from pbench.server.work_queue import WorkQueue
+
+
+_NAME_ = "pbench-dataset-worker"
+
+DEFAULT_POLL_SECONDS = 30
+
+_stop = False
+
+
+def _stop_handler(*args):
+    global _stop
+    _stop = True
+
+
+def main(cfg_name):
+    if not cfg_name:
+        print(
+            f"{_NAME_}: ERROR: No config file specified; set"
+            " _PBENCH_SERVER_CONFIG env variable or use --config <file> on the"
+            " command line",
+            file=sys.stderr,
+        )
+        return 2
+
+    try:
+        config = PbenchServerConfig(cfg_name)
+    except BadConfig as e:
+        print(f"{_NAME_}: {e}", file=sys.stderr)
+        return 3
+
+    logger = get_pbench_logger(_NAME_, config)
+
+    if not WorkQueue.enabled(config, logger):
+        print(
+            f"{_NAME_}: ERROR: The dataset work queue is not enabled; set"
+            ' "dataset-work-queue = yes" in the pbench-server section of the'
+            " config file",
+            file=sys.stderr,
+        )
+        return 4
+
+    try:
+        poll = config.conf.getint(
+            "pbench-server", "dataset-worker-poll-seconds", fallback=None
+        )
+    except ValueError as e:
+        logger.warning("Bad dataset worker poll interval: {}", e)
+        poll = None
+    if poll is None or poll <= 0:
+        poll = DEFAULT_POLL_SECONDS
+
+    # The work queue lives in the Postgres DB.
+    Database.init_db(config, logger)
+
+    queue = WorkQueue(DatasetWorker.states, logger)
+    worker = DatasetWorker(config, logger, queue)
+
+    signal.signal(signal.SIGTERM, _stop_handler)
+    signal.signal(signal.SIGINT, _stop_handler)
+
+    logger.info("{} started (pid {:d})", _NAME_, os.getpid())
+    while not _stop:
+        if not worker.process_one() and not _stop:
+            queue.wait(poll)
+    logger.info("{} stopped (pid {:d})", _NAME_, os.getpid())
+    return 0
+
+
+if __name__ == "__main__":
+    cfg_name = os.environ.get("_PBENCH_SERVER_CONFIG")
+    status = main(cfg_name)
+    sys.exit(status)
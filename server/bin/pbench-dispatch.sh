@@ -49,6 +49,9 @@ log_init $PROG
 # the link source and destination for this script
 linksrc=TODO
 linkdestlist=$(pbench-config -l dispatch-states pbench-server)
+# Optionally trust the checksum fingerprint recorded when the tar ball's MD5
+# sum was verified upstream, instead of computing the MD5 sum again.
+checksum_fingerprints=$(pbench-config checksum-fingerprints pbench-server)
 
 mail_content=$tmp/mail_content.log
 index_content=$tmp/index_mail_contents
@@ -77,15 +80,23 @@ log_info $TS
 # that we process the smallest tar balls first.
 list=$tmp/list
 > ${list}.unsorted
-# First we find all the $linksrc directories
-for linksrc_dir in $(find $ARCHIVE/ -maxdepth 2 -type d -name $linksrc); do
-    # Find all the links in a given $linksrc directory that are
-    # links to actual files (bad links are not emitted!).
-    find -L $linksrc_dir -type f -name '*.tar.xz' -printf "%p\n" 2>/dev/null >> ${list}.unsorted
-    # Find all the links in the same $linksrc directory that don't
-    # link to anything so that we can count them as errors below.
-    find -L $linksrc_dir -type l -name '*.tar.xz' -printf "%p\n" 2>/dev/null >> ${list}.unsorted
-done
+if [ $# -gt 0 ]; then
+    # Only dispatch the given $linksrc links, e.g. those of the datasets
+    # claimed from the work queue by pbench-dataset-worker.
+    for link in "$@"; do
+        echo $link >> ${list}.unsorted
+    done
+else
+    # First we find all the $linksrc directories
+    for linksrc_dir in $(find $ARCHIVE/ -maxdepth 2 -type d -name $linksrc); do
+        # Find all the links in a given $linksrc directory that are
+        # links to actual files (bad links are not emitted!).
+        find -L $linksrc_dir -type f -name '*.tar.xz' -printf "%p\n" 2>/dev/null >> ${list}.unsorted
+        # Find all the links in the same $linksrc directory that don't
+        # link to anything so that we can count them as errors below.
+        find -L $linksrc_dir -type l -name '*.tar.xz' -printf "%p\n" 2>/dev/null >> ${list}.unsorted
+    done
+fi
 # Simple alphabetical sort
 sort ${list}.unsorted > ${list}
 rm -f ${list}.unsorted
@@ -148,7 +159,11 @@ while read tarball ;do
     fi
 
     pushd ${controller_path} > /dev/null 2>&4
-    md5sum --check ${resultname}.tar.xz.md5
+    if [[ "${checksum_fingerprints}" == "yes" ]]; then
+        pbench-verify-md5 ${controller_path}/${resultname}.tar.xz
+    else
+        md5sum --check ${resultname}.tar.xz.md5
+    fi
     sts=$?
     popd >/dev/null 2>&4
     if [ $sts -ne 0 ] ;then
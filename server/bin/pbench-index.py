@@ -19,6 +19,7 @@ from pbench.common.exceptions import (
     ConfigFileError,
     JsonFileError,
 )
+from pbench.server.index_benchmark import BenchmarkShape, run_benchmark
 from pbench.server.indexer import IdxContext
 from pbench.server.indexing_tarballs import Index, SigTermException
 
@@ -36,6 +37,9 @@ def main(options, name):
 
        The caller is required to pass the "options" argument with the following
        expected attributes:
+           benchmark             - Don't do any indexing, but benchmark the
+                                   generation of the documents of a synthetic
+                                   tar ball of the given shape (if not None)
            cfg_name              - Name of the configuration file to use
            dump_index_patterns   - Don't do any indexing, but just emit the
                                    list of index patterns that would be used
@@ -121,6 +125,15 @@ def main(options, name):
         idxctx.templates.dump_templates()
         return 0
 
+    if options.benchmark is not None:
+        try:
+            shape = BenchmarkShape.parse(options.benchmark)
+        except ValueError as e:
+            print(f"{name}: {e}", file=sys.stderr)
+            return error_code["GENERIC_ERROR"].value
+        run_benchmark(idxctx, shape)
+        return 0
+
     res = error_code["OK"]
 
     ARCHIVE_rp = idxctx.config.ARCHIVE
@@ -172,7 +185,7 @@ if __name__ == "__main__":
         sys.exit(1)
     parser = ArgumentParser(
         f"Usage: {run_name} [--config <path-to-config-file>] [--dump-index-patterns]"
-        " [--dump_templates]"
+        " [--dump_templates] [--benchmark [<shape>]] [<tar ball link> ...]"
     )
     parser.add_argument(
         "-C",
@@ -197,6 +210,19 @@ if __name__ == "__main__":
         default=False,
         help="Emit the full JSON document for each index template used",
     )
+    parser.add_argument(
+        "-B",
+        "--benchmark",
+        nargs="?",
+        const="",
+        default=None,
+        dest="benchmark",
+        metavar="SHAPE",
+        help="Benchmark the generation of the documents of a synthetic tar ball"
+        " instead of indexing, where the optional SHAPE is a comma separated list"
+        " of iterations=N, samples=N, hosts=N, tools=N (at most 3), columns=N,"
+        " rows=N, and files=N (additional small files per host)",
+    )
     parser.add_argument(
         "-T",
         "--tool-data",
@@ -213,6 +239,13 @@ if __name__ == "__main__":
         default=False,
         help="Perform re-indexing of previously indexed data",
     )
+    parser.add_argument(
+        "tarballs",
+        nargs="*",
+        help="Only index the given tar balls (their links in the TO-INDEX, or"
+        " TO-INDEX-TOOL, directory), e.g. those of the datasets claimed from the"
+        " work queue by pbench-dataset-worker",
+    )
     parsed = parser.parse_args()
     try:
         # The SIGTERM handler is established around main() to make it easier
@@ -19,12 +19,13 @@ from pathlib import Path
 
 from pbench.common.exceptions import BadConfig
 from pbench.common.logger import get_pbench_logger
-from pbench.common.utils import md5sum
 from pbench.server import PbenchServerConfig
 from pbench.server.report import Report
 from pbench.server.utils import quarantine
 from pbench.server.database.models.tracker import Dataset, States, DatasetError
 from pbench.server.database.database import Database
+from pbench.server.fingerprint import Fingerprints
+from pbench.server.work_queue import WorkQueue
 
 
 _NAME_ = "pbench-server-prep-shim-002"
@@ -82,7 +83,7 @@ def qdirs_check(qdir_val, qdir, logger):
     return qdir
 
 
-def md5_check(tb, tbmd5, logger):
+def md5_check(tb, tbmd5, logger, fingerprints, dataset):
     # read the md5sum from md5 file
     try:
         with tbmd5.open() as f:
@@ -91,9 +92,10 @@ def md5_check(tb, tbmd5, logger):
         archive_md5_hex_value = None
         logger.exception("Quarantine: Could not read {}", tbmd5)
 
-    # get hex value of the tarball's md5sum
+    # get hex value of the tarball's md5sum, trusting its fingerprint if the
+    # upload already verified it
     try:
-        (_, archive_tar_hex_value) = md5sum(tb)
+        archive_tar_hex_value = fingerprints.md5(tb, archive_md5_hex_value, dataset)
     except Exception:
         archive_tar_hex_value = None
         logger.exception("Quarantine: Could not read {}", tb)
@@ -111,6 +113,8 @@ def process_tb(config, logger, receive_dir, qdir_md5, duplicates, errors):
     )
 
     archive = config.ARCHIVE
+    fingerprints = Fingerprints(config, logger)
+    work_queue = WorkQueue.enabled(config, logger)
     logger.info("{}", config.TS)
     list_check.sort()
     nstatus = ""
@@ -166,7 +170,9 @@ def process_tb(config, logger, receive_dir, qdir_md5, duplicates, errors):
             ndups += 1
             continue
 
-        archive_tar_hex_value, archive_md5_hex_value = md5_check(tb, tbmd5, logger)
+        archive_tar_hex_value, archive_md5_hex_value = md5_check(
+            tb, tbmd5, logger, fingerprints, dataset
+        )
         if any(
             [
                 archive_tar_hex_value != archive_md5_hex_value,
@@ -277,6 +283,8 @@ def process_tb(config, logger, receive_dir, qdir_md5, duplicates, errors):
         try:
             if dataset:
                 dataset.advance(States.UPLOADED)
+                if work_queue:
+                    WorkQueue.enqueue(dataset, logger)
         except Exception:
             logger.exception("Unable to finalize {}", dataset)
 
@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+# -*- mode: python -*-
+
+"""Pbench Tar Ball Manifest
+
+Record the manifest of the members of the given tar ball (full path) next to
+the tar ball, so that the indexer can list the members of the tar ball without
+decompressing it again.
+
+With "--stream", the decompressed tar ball is read from stdin, and copied as
+is to stdout, so that the manifest is recorded from the same stream the tar
+ball is unpacked from, e.g.:
+
+    xz -dc <tar ball> | pbench-tarball-manifest --stream <tar ball> | tar -x
+
+The tar ball is always copied in full, even when the manifest can't be
+recorded.
+
+The MD5 sum of the tar ball is taken from its ".md5" file, and recorded in the
+manifest so that the indexer can verify the manifest matches the tar ball.
+
+Return 0 on success, and > 0 on any error.
+"""
+
+import sys
+from pathlib import Path
+from argparse import ArgumentParser
+
+from pbench.server.manifest import TeeReader, manifest_path, write_manifest
+
+
+_NAME_ = "pbench-tarball-manifest"
+
+
+def main(options):
+    tb_path = Path(options.tb_path)
+    tee = TeeReader(sys.stdin.buffer, sys.stdout.buffer) if options.stream else None
+    try:
+        status = record(tb_path, tee)
+    finally:
+        if tee is not None:
+            tee.drain()
+    return status
+
+
+def record(tb_path, tee):
+    if not tb_path.is_file():
+        print(
+            f"{_NAME_}: ERROR: The tar ball, '{tb_path}', does not exist",
+            file=sys.stderr,
+        )
+        return 2
+
+    try:
+        md5sum = Path(f"{tb_path}.md5").read_text().split()[0]
+    except (OSError, IndexError) as e:
+        print(
+            f"{_NAME_}: ERROR: Unable to read the MD5 sum of '{tb_path}': {e}",
+            file=sys.stderr,
+        )
+        return 3
+
+    try:
+        write_manifest(tb_path, md5sum, manifest_path(tb_path), fileobj=tee)
+    except Exception as e:
+        print(
+            f"{_NAME_}: ERROR: Unable to record the manifest of '{tb_path}': {e}",
+            file=sys.stderr,
+        )
+        return 4
+
+    return 0
+
+
+if __name__ == "__main__":
+    prog = Path(sys.argv[0]).name
+    parser = ArgumentParser(f"Usage: {prog} [--stream] <tar ball>")
+    parser.add_argument(
+        "--stream",
+        action="store_true",
+        help="Read the decompressed tar ball from stdin, copying it to stdout",
+    )
+    parser.add_argument("tb_path", help="Specify the full path of the tar ball")
+    parsed = parser.parse_args()
+    status = main(parsed)
+    sys.exit(status)
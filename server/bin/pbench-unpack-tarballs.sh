@@ -51,8 +51,19 @@ linksrc=TO-UNPACK
 linkdest=UNPACKED
 linkerr=WONT-UNPACK
 linkdestlist=$(pbench-config -l unpacked-states pbench-server)
-
-BUCKET="${1}"
+# Optionally record a manifest of each tar ball's members once unpacked, so
+# that indexing does not have to decompress the tar ball again to list them.
+member_manifest=$(pbench-config unpack-member-manifest pbench-server)
+
+if [[ "${1}" == */* ]]; then
+    # Only unpack the given ${linksrc} links (full paths), e.g. those of the
+    # datasets claimed from the work queue by pbench-dataset-worker.
+    tarballs=( "${@}" )
+    BUCKET=""
+else
+    tarballs=()
+    BUCKET="${1}"
+fi
 if [[ -z "${BUCKET}" ]]; then
     lb_arg=""
     ub_arg=""
@@ -110,18 +121,29 @@ function gen_work_list() {
     # that we process the tar balls from newest to oldest.
     rm -f ${list}
     > ${list}.unsorted
-    # First we find all the ${linksrc} directories
-    for linksrc_dir in $(find ${ARCHIVE}/ -maxdepth 2 -type d -name ${linksrc}); do
-        # Find all the links in a given ${linksrc} directory that are links to
-        # actual files (bad links are not emitted!).  For now, if it's a
-        # duplicate name, just punt and avoid producing an error.
-        find -L ${linksrc_dir} -type f -name '*.tar.xz' ! -name 'DUPLICATE__NAME*' ${lb_arg} ${ub_arg} -printf "%TY-%Tm-%TdT%TT %s %p\n" 2>/dev/null >> ${list}.unsorted
-        if [[ ${lowerbound} == 0 ]]; then
-            # Find all the links in the same ${linksrc} directory that don't
-            # link to anything so that we can count them as errors below.
-            find -L $linksrc_dir -type l -name '*.tar.xz' ! -name 'DUPLICATE__NAME*' -printf "%TY-%Tm-%TdT%TT %s %p\n" 2>/dev/null >> ${list}.unsorted
-        fi
-    done
+    if [[ ${#tarballs[@]} -gt 0 ]]; then
+        # The given links, as long as they are still links in ${linksrc}.
+        for tb in "${tarballs[@]}"; do
+            if [[ ! -L "${tb}" || "$(basename -- "$(dirname -- "${tb}")")" != "${linksrc}" ]]; then
+                continue
+            fi
+            find -L "${tb}" -type f -printf "%TY-%Tm-%TdT%TT %s %p\n" 2>/dev/null >> ${list}.unsorted
+            find -L "${tb}" -type l -printf "%TY-%Tm-%TdT%TT %s %p\n" 2>/dev/null >> ${list}.unsorted
+        done
+    else
+        # First we find all the ${linksrc} directories
+        for linksrc_dir in $(find ${ARCHIVE}/ -maxdepth 2 -type d -name ${linksrc}); do
+            # Find all the links in a given ${linksrc} directory that are links to
+            # actual files (bad links are not emitted!).  For now, if it's a
+            # duplicate name, just punt and avoid producing an error.
+            find -L ${linksrc_dir} -type f -name '*.tar.xz' ! -name 'DUPLICATE__NAME*' ${lb_arg} ${ub_arg} -printf "%TY-%Tm-%TdT%TT %s %p\n" 2>/dev/null >> ${list}.unsorted
+            if [[ ${lowerbound} == 0 ]]; then
+                # Find all the links in the same ${linksrc} directory that don't
+                # link to anything so that we can count them as errors below.
+                find -L $linksrc_dir -type l -name '*.tar.xz' ! -name 'DUPLICATE__NAME*' -printf "%TY-%Tm-%TdT%TT %s %p\n" 2>/dev/null >> ${list}.unsorted
+            fi
+        done
+    fi
     sort -k 1 -r ${list}.unsorted > ${list}
     rm -f ${list}.unsorted
     # Pad by one minute, the default smallest cronjob interval.
@@ -219,8 +241,20 @@ function do_work() {
         fi
 
         let start_time=$(timestamp-seconds-since-epoch)
-        tar --extract --no-same-owner --touch --delay-directory-restore --file="${result}" --force-local --directory="${incoming}.unpack"
-        status=${?}
+        manifest_status=0
+        if [[ "${member_manifest}" == "yes" ]]; then
+            # Record the manifest next to the tar ball from the same
+            # decompressed stream being unpacked, which it passes through.
+            xz --decompress --stdout -- "${result}" \
+                | pbench-tarball-manifest --stream "${link}" \
+                | tar --extract --no-same-owner --touch --delay-directory-restore --file=- --directory="${incoming}.unpack"
+            pipe_status=( ${PIPESTATUS[@]} )
+            status=$(( ${pipe_status[0]} + ${pipe_status[2]} ))
+            manifest_status=${pipe_status[1]}
+        else
+            tar --extract --no-same-owner --touch --delay-directory-restore --file="${result}" --force-local --directory="${incoming}.unpack"
+            status=${?}
+        fi
         if [[ ${status} -ne 0 ]]; then
             log_error "${TS}: 'tar -xf ${result}' failed: code ${status}" "${mail_content}"
             rm -rf ${incoming}.unpack
@@ -254,6 +288,13 @@ function do_work() {
             continue
         fi
 
+        if [[ ${manifest_status} -ne 0 ]]; then
+            # Not fatal, the indexer lists the members from the tar ball
+            # itself when there is no manifest.
+            log_error "${TS}: WARNING - 'pbench-tarball-manifest ${link}' failed: code ${manifest_status}" "${mail_content}"
+            nwarn=${nwarn}+1
+        fi
+
         # Move the final unpacked tar ball into place
         mv ${incoming}.unpack/${resultname} ${INCOMING}/${hostname}/
         status=${?}
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+# -*- mode: python -*-
+
+"""Pbench Verify MD5
+
+Check the MD5 sum of the given tar ball (full path) against its ".md5" file,
+as "md5sum --check" does, trusting the checksum fingerprint recorded for its
+dataset when it still matches the tar ball (see pbench.server.fingerprint).
+
+Prints "<tar ball name>: OK" or "<tar ball name>: FAILED".
+
+Return 0 if the MD5 sum matches, 1 if it does not, and > 1 on any error.
+"""
+
+import os
+import sys
+from argparse import ArgumentParser
+from pathlib import Path
+
+from pbench.common.exceptions import BadConfig
+from pbench.common.logger import get_pbench_logger
+from pbench.server import PbenchServerConfig
+from pbench.server.database.database import Database
+from pbench.server.fingerprint import Fingerprints
+
+
+_NAME_ = "pbench-verify-md5"
+
+
+def main(cfg_name, options):
+    if not cfg_name:
+        print(
+            f"{_NAME_}: ERROR: No config file specified; set"
+            " _PBENCH_SERVER_CONFIG env variable or use --config <file> on the"
+            " command line",
+            file=sys.stderr,
+        )
+        return 2
+
+    try:
+        config = PbenchServerConfig(cfg_name)
+    except BadConfig as e:
+        print(f"{_NAME_}: {e}", file=sys.stderr)
+        return 3
+
+    logger = get_pbench_logger(_NAME_, config)
+
+    # The checksum fingerprints are recorded in the Postgres DB.
+    Database.init_db(config, logger)
+
+    tb_path = Path(options.tb_path)
+    try:
+        md5sum = Path(f"{tb_path}.md5").read_text().split()[0]
+    except (OSError, IndexError) as e:
+        print(
+            f"{_NAME_}: ERROR: Unable to read the MD5 sum of '{tb_path}': {e}",
+            file=sys.stderr,
+        )
+        return 4
+
+    try:
+        computed = Fingerprints(config, logger).md5(tb_path, md5sum)
+    except OSError as e:
+        print(f"{_NAME_}: ERROR: Unable to read '{tb_path}': {e}", file=sys.stderr)
+        return 5
+
+    if computed != md5sum:
+        print(f"{tb_path.name}: FAILED")
+        return 1
+    print(f"{tb_path.name}: OK")
+    return 0
+
+
+if __name__ == "__main__":
+    prog = Path(sys.argv[0]).name
+    parser = ArgumentParser(f"Usage: {prog} <tar ball>")
+    parser.add_argument("tb_path", help="Specify the full path of the tar ball")
+    parsed = parser.parse_args()
+    cfg_name = os.environ.get("_PBENCH_SERVER_CONFIG")
+    status = main(cfg_name, parsed)
+    sys.exit(status)